@@ -0,0 +1,203 @@
+//  ---------------------------------------------
+//  Runs a N-body simulation without user interface
+//  ---------------------------------------------
+#include <charconv> // std::from_chars
+#include <chrono> // std::chrono::*
+#include <cstdint> // std::uint64_t
+#include <exception>
+#include <iostream>
+#include <memory> // std::unique_ptr, std::make_unique
+#include <optional>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <system_error> // std::errc
+#include <vector>
+
+#include "universe.hpp" // Universe
+#include "scenarios.hpp" // scenarios::*
+#include "simulation.hpp" // Simulation
+#include "diagnostics.hpp" // Diagnostics
+#include "sampling.hpp" // sampling::*
+#include "csv-export.hpp" // csv::FileSink
+#include "trajectory-file.hpp" // trajectory::Writer
+#include "async-sink.hpp" // AsyncSink
+#include "merger-log.hpp" // mergers::Log
+#include "checkpoint.hpp" // Checkpoint, CheckpointWriter
+#include "frames-sink.hpp" // frames::Sink
+
+
+//----------------------------------------------------------------------
+void print_usage()
+{
+    std::cerr << "Usage: n-body-batch <scenario> <T> <dt> [options]\n"
+                 "  scenario:\n"
+                 "    small-around-big\n"
+                 "    coll-test\n"
+                 "    uniform:<N>[:<seed>]    N bodies scattered in a disk\n"
+                 "    <file>                  A checkpoint to restart from\n"
+                 "  options:\n"
+                 "    --bounce                Colliding bodies bounce instead of merging\n"
+                 "    --every <steps>         Bodies sampling period (default 100)\n"
+                 "    --csv <file>            Energies and center of mass at each step\n"
+                 "    --traj <file>           Binary trajectory of the sampled bodies\n"
+                 "    --mergers <file>        Log of the mergers\n"
+                 "    --frames <file|-> [<w>x<h>]  Images of the sampled bodies (binary PPM)\n"
+                 "    --checkpoint <file> <steps>\n";
+}
+
+//----------------------------------------------------------------------
+template<typename T> [[nodiscard]] T to_num(const std::string_view sv)
+{
+    T v{};
+    const auto [ptr, ec] = std::from_chars(sv.data(), sv.data()+sv.size(), v);
+    if( ec!=std::errc{} or ptr!=sv.data()+sv.size() ) throw std::runtime_error("Invalid number: " + std::string(sv));
+    return v;
+}
+
+//----------------------------------------------------------------------
+// A checkpoint brings also the run state of the simulation
+[[nodiscard]] Universe create_universe(const std::string_view scenario, std::string& run_state)
+{
+    if( scenario=="small-around-big" ) return scenarios::small_around_big();
+    if( scenario=="coll-test" ) return scenarios::coll_test();
+    if( scenario.starts_with("uniform:") )
+       {
+        std::string_view args = scenario.substr(8);
+        const auto sep = args.find(':');
+        const auto N = to_num<std::size_t>(args.substr(0, sep));
+        const auto seed = sep==std::string_view::npos ? std::uint64_t{1} : to_num<std::uint64_t>(args.substr(sep+1));
+        return scenarios::uniform_disk(N, seed);
+       }
+    return Checkpoint::load(std::string(scenario), &run_state);
+}
+
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const std::vector<std::string_view> args(argv+1, argv+argc);
+    if( args.size()<3 )
+       {
+        print_usage();
+        return 2;
+       }
+
+    try{
+        const auto t_start = std::chrono::steady_clock::now();
+        std::string run_state;
+        Universe universe = create_universe(args[0], run_state);
+        const auto T = to_num<double>(args[1]);
+        const auto dt = to_num<double>(args[2]);
+
+        std::size_t bodies_every = 100;
+        std::optional<std::string> csv_path, traj_path, mergers_path, checkpoint_path, frames_path;
+        std::size_t frame_w = 800, frame_h = 800;
+        std::size_t checkpoint_steps = 0;
+        for( std::size_t i=3; i<args.size(); ++i )
+           {
+            auto next = [&]() -> std::string_view
+               {
+                if( ++i>=args.size() ) throw std::runtime_error("Missing argument after " + std::string(args[i-1]));
+                return args[i];
+               };
+            if( args[i]=="--bounce" ) universe.set_collision_mode(Universe::CollisionMode::bounce);
+            else if( args[i]=="--every" ) bodies_every = to_num<std::size_t>(next());
+            else if( args[i]=="--csv" ) csv_path = next();
+            else if( args[i]=="--traj" ) traj_path = next();
+            else if( args[i]=="--mergers" ) mergers_path = next();
+            else if( args[i]=="--frames" )
+               {
+                frames_path = next();
+                if( i+1<args.size() and not args[i+1].starts_with("--") )
+                   {
+                    const std::string_view siz = next();
+                    const auto sep = siz.find('x');
+                    if( sep==std::string_view::npos ) throw std::runtime_error("Invalid image size " + std::string(siz));
+                    frame_w = to_num<std::size_t>(siz.substr(0, sep));
+                    frame_h = to_num<std::size_t>(siz.substr(sep+1));
+                   }
+               }
+            else if( args[i]=="--checkpoint" )
+               {
+                checkpoint_path = next();
+                checkpoint_steps = to_num<std::size_t>(next());
+               }
+            else throw std::runtime_error("Unknown option " + std::string(args[i]));
+           }
+
+        // Outputs
+        Simulation sim(1);
+        if( not run_state.empty() ) sim.restore_run_state(run_state);
+        MultiSink sinks;
+        std::unique_ptr<csv::FileSink> csv_sink;
+        if( csv_path )
+           {
+            csv_sink = std::make_unique<csv::FileSink>(*csv_path, csv::Columns{csv::Column::energies, csv::Column::cm});
+            sinks.add(*csv_sink);
+           }
+        std::unique_ptr<trajectory::Writer> traj_sink;
+        if( traj_path )
+           {
+            traj_sink = std::make_unique<trajectory::Writer>(*traj_path, universe.bodies().size(), dt);
+            sinks.add(*traj_sink);
+           }
+        std::unique_ptr<frames::Sink> frames_sink;
+        if( frames_path )
+           {
+            const auto window = frames::Window::around(universe.bodies(), static_cast<double>(frame_w)/static_cast<double>(frame_h));
+            frames_sink = std::make_unique<frames::Sink>(*frames_path, window, frame_w, frame_h);
+            sinks.add(*frames_sink);
+           }
+        std::unique_ptr<mergers::Log> mergers_log;
+        if( mergers_path )
+           {
+            mergers_log = std::make_unique<mergers::Log>(*mergers_path);
+            sim.log_mergers_to(*mergers_log);
+           }
+        std::unique_ptr<CheckpointWriter> checkpoint;
+        if( checkpoint_path and checkpoint_steps>0 )
+           {
+            checkpoint = std::make_unique<CheckpointWriter>(*checkpoint_path);
+            sim.checkpoint_every(checkpoint_steps, *checkpoint);
+           }
+
+        sampling::Policy policy;
+        policy.bodies = (traj_sink or frames_sink) and bodies_every>0 ? sampling::Cadence::every_steps(bodies_every) : sampling::Cadence::never();
+        policy.energies = policy.cm = csv_sink ? sampling::Cadence::every_step() : sampling::Cadence::never();
+        sim.set_sampling(policy);
+        Diagnostics diagnostics(sampling::Cadence::every_time(T/100.0));
+        diagnostics.record(universe);
+        sim.monitor_with(diagnostics);
+
+        const std::size_t N0 = universe.bodies().size();
+        const double t0 = universe.time();
+        const auto t_run = std::chrono::steady_clock::now();
+           {
+            AsyncSink async_sinks(sinks);
+            sim.execute(universe, T, dt, async_sinks);
+           }
+        if( checkpoint ) checkpoint->wait();
+        if( mergers_log ) mergers_log->finish();
+        if( traj_sink ) traj_sink->close();
+        const auto t_end = std::chrono::steady_clock::now();
+
+        const double run_s = std::chrono::duration<double>(t_end - t_run).count();
+        const double steps = (universe.time() - t0)/dt;
+        // Frames may go to the standard output
+        std::ostream& out = frames_path==std::optional<std::string>{"-"} ? std::cerr : std::cout;
+        out << "bodies: " << N0 << " -> " << universe.bodies().size()
+                  << " (" << universe.escaped().size() << " escaped)\n"
+                  << "simulated time: " << universe.time() << '\n'
+                  << "setup: " << std::chrono::duration<double>(t_run - t_start).count() << " s\n"
+                  << "run: " << run_s << " s, " << steps/run_s << " steps/s\n"
+                  << "max energy drift: " << diagnostics.max_energy_drift() << '\n';
+       }
+    catch( std::exception& e )
+       {
+        std::cerr << e.what() << '\n';
+        return 1;
+       }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+//  ---------------------------------------------
+//  Writes samples on a dedicated thread
+//  ---------------------------------------------
+#include <atomic>
+#include <cstddef> // std::size_t
+#include <exception> // std::exception_ptr
+#include <thread> // std::jthread
+#include <vector>
+
+#include "sample.hpp" // Sample, SampleSink
+#include "spsc-queue.hpp" // SpscQueue
+
+
+////////////////////////////////////////////////////////////////////////
+// Decouples the step loop from the disk: the samples are copied in
+// recycled buffers and handed through a lock-free queue to an I/O thread
+// that calls the wrapped sink, so encoding and writing don't slow the
+// simulation. The step loop waits only when all the buffers are taken.
+// An error of the wrapped sink stops the writing, the next samples are
+// discarded and the error is thrown by the next push() or finish()
+class AsyncSink final : public SampleSink
+{
+ private:
+    SampleSink& m_sink; // The one that encodes and writes
+    std::vector<Sample> m_buffers;
+    SpscQueue<Sample*> m_full; // To be written
+    SpscQueue<Sample*> m_free; // Written, can be reused
+    std::atomic<std::size_t> m_pending{0}; // Samples not yet written
+    std::exception_ptr m_error; // Of the wrapped sink, set before m_failed
+    std::atomic<bool> m_failed{false};
+    std::jthread m_io_thread; // Declared last, so it stops before the rest is destroyed
+
+ public:
+    explicit AsyncSink(SampleSink& sink, const std::size_t buffers_count =2)
+      : m_sink(sink)
+      , m_buffers(buffers_count>0 ? buffers_count : 1)
+      , m_full(m_buffers.size()+1) // Room for the stop request
+      , m_free(m_buffers.size())
+       {
+        for( Sample& buf : m_buffers ) m_free.push(&buf);
+        m_io_thread = std::jthread([this]{ write_loop(); });
+       }
+
+    ~AsyncSink()
+       {
+        m_full.push(nullptr); // Stop request, after the pending ones
+        m_io_thread.join();
+       }
+
+    AsyncSink(const AsyncSink&) = delete;
+    AsyncSink& operator=(const AsyncSink&) = delete;
+
+    //-----------------------------------------------------------------------
+    void push(const Sample& s) override
+       {
+        check();
+        Sample* const buf = m_free.pop();
+        buf->time = s.time;
+        buf->bodies.assign(s.bodies.begin(), s.bodies.end()); // Reusing capacity
+        buf->Cm = s.Cm;
+        buf->Ek = s.Ek;
+        buf->Eu = s.Eu;
+        buf->content = s.content;
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        m_full.push(buf);
+       }
+
+    //-----------------------------------------------------------------------
+    void finish() override
+       {// Wait the pending samples, then the wrapped sink can be finished here
+        for( std::size_t n=m_pending.load(std::memory_order_acquire); n>0; n=m_pending.load(std::memory_order_acquire) )
+           {
+            m_pending.wait(n, std::memory_order_acquire);
+           }
+        check();
+        m_sink.finish();
+       }
+
+ private:
+    //-----------------------------------------------------------------------
+    void write_loop()
+       {
+        while( Sample* const buf = m_full.pop() )
+           {
+            if( not m_failed.load(std::memory_order_relaxed) )
+               {
+                try{ m_sink.push(*buf); }
+                catch(...)
+                   {
+                    m_error = std::current_exception();
+                    m_failed.store(true, std::memory_order_release);
+                   }
+               }
+            m_free.push(buf);
+            m_pending.fetch_sub(1, std::memory_order_release);
+            m_pending.notify_one();
+           }
+       }
+
+    void check() const
+       {
+        if( m_failed.load(std::memory_order_acquire) ) std::rethrow_exception(m_error);
+       }
+};
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <stdexcept> // std::runtime_error
+static ut::suite<"AsyncSink"> async_sink_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("AsyncSink error of the wrapped sink") = []
+   {
+    class FailingSink final : public SampleSink
+       {
+        public:
+            std::size_t pushed = 0;
+            void push(const Sample&) override
+               {
+                if( ++pushed==3 ) throw std::runtime_error("Disk full");
+               }
+            void finish() override {}
+       } sink;
+
+    AsyncSink async(sink);
+    Sample s{};
+    auto push_all = [&]{ for( int i=0; i<10; ++i ) async.push(s); async.finish(); };
+    ut::expect( ut::throws<std::runtime_error>(push_all) );
+    ut::expect( sink.pushed==3u ); // No more after the error
+    ut::expect( ut::throws<std::runtime_error>([&]{ async.finish(); }) );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
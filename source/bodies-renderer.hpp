@@ -0,0 +1,104 @@
+#pragma once
+//  ---------------------------------------------
+//  Draws all the bodies with a single call
+//  ---------------------------------------------
+#include <array>
+#include <algorithm> // std::min, std::max
+#include <cmath> // std::cos, std::sin
+#include <numbers> // std::numbers::pi
+#include <vector>
+
+#include <SFML/Graphics.hpp> // sf::*
+
+#include "sfml-addons-color.hpp" // sfadd::Color
+#include "universe.hpp" // Universe
+
+
+////////////////////////////////////////////////////////////////////////
+// The bodies are polygons in one persistent vertex array, refilled each
+// frame; the colors come from a table indexed by mass.
+// Just the visible bodies are drawn, with a detail depending on their
+// size on screen: the ones smaller than a pixel are points, the others
+// polygons with a number of sides growing with their radius
+class BodiesRenderer final : public sf::Drawable
+{
+ private:
+    static constexpr std::size_t min_segments = 8; // Of each polygon
+    static constexpr std::size_t max_segments = 64; // Power of two multiple of min_segments
+    std::array<sf::Vector2f,max_segments+1> m_unit_circle;
+    static constexpr float max_palette_index = 255.0f;
+    std::array<sf::Color,256> m_palette; // Mass → color
+    float m_palette_k; // Mass to palette index
+    sf::VertexArray m_vertices{sf::Triangles};
+    sf::VertexArray m_points{sf::Points}; // Sub-pixel bodies
+
+ public:
+    //                                        Mass that gets the brightest color
+    explicit BodiesRenderer(const double max_mass =10000.0)
+      : m_palette_k( max_palette_index / static_cast<float>(max_mass) )
+       {
+        for( std::size_t i=0; i<=max_segments; ++i )
+           {
+            const double a = 2.0 * std::numbers::pi * static_cast<double>(i) / max_segments;
+            m_unit_circle[i] = { static_cast<float>(std::cos(a)), static_cast<float>(std::sin(a)) };
+           }
+
+        for( std::size_t i=0; i<m_palette.size(); ++i )
+           {
+            sfadd::Color col{78,72,8};
+            col.lum_incr( static_cast<float>(i) / max_palette_index );
+            m_palette[i] = col;
+           }
+       }
+
+    [[nodiscard]] sf::Color color_of(const double mass) const noexcept
+       {
+        const float k = std::min(m_palette_k * static_cast<float>(mass), max_palette_index);
+        return m_palette[ static_cast<std::size_t>(k) ];
+       }
+
+    //                                                                   Visible area      Size of a pixel [<space>]   Fraction of last step to show
+    void update(const std::vector<Universe::Body>& bodies, const sf::FloatRect& view_rect, const float pixel_size, const float alpha =1.0f)
+       {
+        m_vertices.clear();
+        m_points.clear();
+        const float right = view_rect.left + view_rect.width;
+        const float bottom = view_rect.top + view_rect.height;
+        for( const auto& body : bodies )
+           {
+            const Universe::Vect& p0 = body.previous_position();
+            const Universe::Vect p = p0 + static_cast<double>(alpha) * (body.position() - p0);
+            const sf::Vector2f c{ static_cast<float>(p.x), static_cast<float>(p.y) };
+            const float r = static_cast<float>(body.radius());
+            if( c.x+r<view_rect.left or c.x-r>right or c.y+r<view_rect.top or c.y-r>bottom ) continue;
+
+            const sf::Color col = color_of(body.mass());
+            const float r_pix = r / pixel_size;
+            if( r_pix<1.0f )
+               {
+                m_points.append( sf::Vertex(c, col) );
+                continue;
+               }
+
+            // Sides count proportional to the radius on screen (sides of some pixels)
+            std::size_t step = 1;
+            while( max_segments/step > min_segments and static_cast<float>(max_segments/step) > r_pix ) step *= 2;
+            for( std::size_t i=0; i<max_segments; i+=step )
+               {
+                m_vertices.append( sf::Vertex(c, col) );
+                m_vertices.append( sf::Vertex(c + m_unit_circle[i]*r, col) );
+                m_vertices.append( sf::Vertex(c + m_unit_circle[i+step]*r, col) );
+               }
+           }
+       }
+
+    [[nodiscard]] std::size_t points_count() const noexcept { return m_points.getVertexCount(); }
+    [[nodiscard]] std::size_t triangles_count() const noexcept { return m_vertices.getVertexCount()/3; }
+
+ private:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+       {
+        target.draw(m_vertices, states);
+        target.draw(m_points, states);
+       }
+};
@@ -3,19 +3,26 @@
 //  A spherical body for n-body simulation
 //  ---------------------------------------------
 #include <stdexcept>
-#include <cmath> // std::log10, std::cbrt
+#include <cstdint> // std::uint64_t
+#include <optional> // std::optional
+#include <cmath> // std::log10, std::cbrt, std::sqrt
 #include <numbers> // std::numbers::pi
 #include "math-utilities.hpp" // math::*
 
+class Checkpoint;
 
 ////////////////////////////////////////////////////////////////////////
 template<class Vect> class SphericalBody final
 {
+    friend class Checkpoint; // Accesses the whole state
+
  public:
-    SphericalBody(const double m, const Vect& pos, const Vect& spd)
-      : i_mass(m)
+    SphericalBody(const double m, const Vect& pos, const Vect& spd, const std::uint64_t id =0)
+      : i_id(id)
+      , i_mass(m)
       , i_radius(calc_radius_from_mass(i_mass))
       , i_pos(pos)
+      , i_prev_pos(pos)
       , i_spd(spd)
        {
         if( math::is_zero(i_mass) )
@@ -30,12 +37,14 @@ template<class Vect> class SphericalBody final
         return std::cbrt(m/(density() * (4.0/3.0) * std::numbers::pi));
        }
 
+    [[nodiscard]] std::uint64_t id() const noexcept { return i_id; }
     [[nodiscard]] double mass() const noexcept { return i_mass; }
     [[nodiscard]] double radius() const noexcept { return i_radius; }
     [[nodiscard]] static double density() noexcept { return 1.0; }
     [[nodiscard]] double volume() const noexcept { return (4.0/3.0) * std::numbers::pi * math::cube(i_radius); }
 
     [[nodiscard]] const Vect& position() const noexcept { return i_pos; }
+    [[nodiscard]] const Vect& previous_position() const noexcept { return i_prev_pos; }
     [[nodiscard]] const Vect& speed() const noexcept { return i_spd; }
     [[nodiscard]] const Vect& acceleration() const noexcept { return i_acc; }
 
@@ -63,6 +72,15 @@ template<class Vect> class SphericalBody final
         return math::ratio(G * mass() * other.mass(), d*d*d) * disp;
        }
 
+    [[nodiscard]] Vect gravitational_force_on(const SphericalBody& other, const double G, double& U) const noexcept
+       {// Same as above, also accumulating the potential energy U = -G · M·m / d
+        const Vect disp = displacement_from(other);
+        const double d = disp.norm();
+        const double Gmm = G * mass() * other.mass();
+        U -= math::ratio(Gmm, d);
+        return math::ratio(Gmm, d*d*d) * disp;
+       }
+
     [[nodiscard]] double gravitational_energy_with(const SphericalBody& other, const double G) const noexcept
        {// U = -G · mi·mj / d
         const double d = displacement_from(other).norm();
@@ -81,9 +99,69 @@ template<class Vect> class SphericalBody final
 
     void evolve_position(const double dt) noexcept
        {
+        i_prev_pos = i_pos;
         i_pos += dt * i_spd;
        }
 
+    [[nodiscard]] std::optional<double> time_of_impact_with(const SphericalBody& other) const noexcept
+       {// Swept spheres: the relative displacement is assumed to move
+        // linearly during the last step, d⃗(s) = d⃗₀ + s·𝛥d⃗ with s∈[0,1],
+        // so the contact |d⃗(s)|=R is the smallest root of:
+        //   |𝛥d⃗|²·s² + 2·(d⃗₀·𝛥d⃗)·s + |d⃗₀|²-R² = 0
+        // Returns the fraction of the last step at the impact
+        const Vect d0 = previous_position() - other.previous_position();
+        const Vect dd = displacement_from(other) - d0;
+        const double R = radius() + other.radius();
+        const double c = d0.norm2() - R*R;
+        if( c<=0.0 ) return 0.0; // Were already touching
+        const double b = dot_prod(d0,dd);
+        if( b>=0.0 ) return std::nullopt; // Not approaching
+        const double a = dd.norm2();
+        const double disc = b*b - a*c;
+        if( disc<0.0 ) return std::nullopt; // Passing by
+        const double s = (-b - std::sqrt(disc)) / a;
+        if( s>1.0 ) return std::nullopt; // Not yet
+        return s;
+       }
+
+    [[nodiscard]] Vect displacement_during_last_step_from(const SphericalBody& other, const double s) const noexcept
+       {// At fraction s of the last step
+        const Vect d0 = previous_position() - other.previous_position();
+        return d0 + s*(displacement_from(other) - d0);
+       }
+
+    [[nodiscard]] Vect speed_during_last_step(const double dt) const noexcept
+       {// Of the swept motion, the one of the impacts detection: unlike the
+        // speed at the end of the step it doesn't include the acceleration
+        // of an overlap with another body
+        return math::ratio(1.0, dt) * (i_pos - i_prev_pos);
+       }
+
+    [[nodiscard]] Vect collision_impulse_from(const SphericalBody& other, const double s, const double Cr) const noexcept
+       {// The impulse I get colliding with other at fraction s of the last step
+        // Cr: Coefficient of restitution of collisions (anelastic) 0÷1 (elastic)
+        const Vect displacement = other.displacement_during_last_step_from(*this, s);
+        const double dist = displacement.norm();
+        if( math::is_zero(dist) ) return Vect{};
+        const Vect n⃗ = displacement/dist; // Normal versor, from me to other
+        const double vrₙ = dot_prod(speed() - other.speed(), n⃗);
+        if( vrₙ<=1E-3 ) return Vect{}; // Moving away
+        // In = m₁·m₂/(m₁+m₂) · (1+Cr) · vrₙ
+        const double In = ((mass() * other.mass()) / (mass() + other.mass()))
+                          * (1.0+Cr) * vrₙ;
+        return -In * n⃗;
+       }
+
+    void apply_impulse(const Vect& I) noexcept
+       {
+        i_spd += (1.0/i_mass) * I;
+       }
+
+    void replay_last_step_from(const double s, const double dt) noexcept
+       {// Move from where I was at fraction s of the last step with current speed
+        i_pos = i_prev_pos + s*(i_pos - i_prev_pos) + ((1.0-s)*dt) * i_spd;
+       }
+
     void handle_possible_collision_with(SphericalBody& other, const double Cr =1.0) noexcept
        {
         // Cr: Coefficient of restitution of collisions (anelastic) 0÷1 (elastic)
@@ -123,15 +201,61 @@ template<class Vect> class SphericalBody final
        {
         // This should conserve the linear momentum
         const double combined_mass = mass() + other.mass();
+        // The center of mass of the two moves linearly during the step,
+        // so placing the merged body there is right whatever the impact time
+        i_pos = ((mass() * position()) + (other.mass() * other.position())) / combined_mass;
+        i_prev_pos = ((mass() * previous_position()) + (other.mass() * other.previous_position())) / combined_mass;
         i_spd = ((mass() * speed()) + (other.mass() * other.speed())) / combined_mass;
         i_mass = combined_mass;
         i_radius = calc_radius_from_mass(i_mass);
        }
 
  private:
+    std::uint64_t i_id; // Identifier given by the owner
     double i_mass;
     double i_radius; // [<space>]
     Vect i_pos, // Position [<space>]
+         i_prev_pos, // Position before last step [<space>]
          i_spd, // Speed [<space>/<time>]
          i_acc; // Acceleration [<space>/<time>²]
 };
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include "Vect2D.hpp" // Vect2D
+static ut::suite<"SphericalBody"> body_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("SphericalBody::time_of_impact_with") = []
+   {
+    using Body = SphericalBody<Vect2D>;
+
+    ut::test("tunneling bodies") = []
+       {
+        Body b1(1.0, {0.0,0.0}, {100.0,0.0});
+        Body b2(1.0, {50.0,0.0}, {-100.0,0.0});
+        b1.evolve_position(1.0);
+        b2.evolve_position(1.0);
+        ut::expect( b1.displacement_from(b2).norm() > b1.radius()+b2.radius() );
+
+        const auto s = b1.time_of_impact_with(b2);
+        ut::expect( s.has_value() and *s>0.2 and *s<0.25 );
+       };
+
+    ut::test("receding bodies") = []
+       {
+        Body b1(1.0, {0.0,0.0}, {-10.0,0.0});
+        Body b2(1.0, {5.0,0.0}, {10.0,0.0});
+        b1.evolve_position(1.0);
+        b2.evolve_position(1.0);
+        ut::expect( not b1.time_of_impact_with(b2).has_value() );
+       };
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
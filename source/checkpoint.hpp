@@ -0,0 +1,297 @@
+#pragma once
+//  ---------------------------------------------
+//  Checkpoint and restart of a N-body model
+//  ---------------------------------------------
+//  Layout (native endianness):
+//    "NBCHKPT1" f64:G f64:t f64:dt u64:next id u8:collision mode
+//    f64:Cr f64:skin f64:escape radius f64:escaped mass
+//    f64:escaped momentum.x f64:escaped momentum.y
+//    u64:bodies count, bodies u64:escaped count, escaped bodies
+//    u64:user state size, user state bytes
+//    where each body is: u64:id f64:mass f64:radius f64:pos.x f64:pos.y
+//    f64:prev pos.x f64:prev pos.y f64:spd.x f64:spd.y f64:acc.x f64:acc.y
+#include <algorithm> // std::min
+#include <cstdint> // std::uint8_t, std::uint64_t
+#include <cstdio> // std::rename, std::remove
+#include <cstring> // std::memcpy
+#include <fstream>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <thread> // std::jthread
+#include <exception> // std::exception_ptr
+#include <type_traits> // std::is_same_v
+#include <utility> // std::move
+#include <vector>
+
+#include "universe.hpp" // Universe
+#include "mapped-file.hpp" // MappedFile
+
+
+////////////////////////////////////////////////////////////////////////
+// The whole state is stored with full precision, so a restored universe
+// evolves exactly like the original one. The application can attach its
+// own state too (for example a serialized random engine)
+class Checkpoint final
+{
+    using Body = Universe::Body;
+    using Vect = Universe::Vect;
+    static constexpr std::string_view magic{"NBCHKPT1"};
+
+ public:
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static std::vector<char> encode(const Universe& u, const std::string_view user_state ={})
+       {
+        std::vector<char> buf;
+        buf.reserve(128 + (u.m_bodies.size() + u.m_escaped.size()) * body_size + user_state.size());
+        buf.insert(buf.end(), magic.begin(), magic.end());
+        put(buf, u.G);
+        put(buf, u.t);
+        put(buf, u.m_dt);
+        put(buf, u.m_next_id);
+        put(buf, static_cast<std::uint8_t>(u.m_collision_mode));
+        put(buf, u.m_Cr);
+        put(buf, u.m_neighbors.skin());
+        put(buf, u.m_escape_radius);
+        put(buf, u.m_escaped_mass);
+        put(buf, u.m_escaped_momentum);
+        put(buf, static_cast<std::uint64_t>(u.m_bodies.size()));
+        for( const Body& body : u.m_bodies ) put(buf, body);
+        put(buf, static_cast<std::uint64_t>(u.m_escaped.size()));
+        for( const Body& body : u.m_escaped ) put(buf, body);
+        put(buf, static_cast<std::uint64_t>(user_state.size()));
+        buf.insert(buf.end(), user_state.begin(), user_state.end());
+        return buf;
+       }
+
+    //-----------------------------------------------------------------------
+    static void save(const std::vector<char>& encoded, const std::string& fpath)
+       {// Through a temporary file, an interrupted write won't spoil the last checkpoint
+        const std::string tmp_path = fpath + ".tmp";
+           {
+            std::ofstream f(tmp_path, std::ios::out | std::ios::binary);
+            if(!f.is_open()) throw std::runtime_error("Unable to open file " + tmp_path);
+            f.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+            if(!f) throw std::runtime_error("Unable to write " + tmp_path);
+           }
+        std::remove(fpath.c_str()); // Needed on Windows
+        if( std::rename(tmp_path.c_str(), fpath.c_str())!=0 ) throw std::runtime_error("Unable to write " + fpath);
+       }
+
+    static void save(const Universe& u, const std::string& fpath, const std::string_view user_state ={})
+       {
+        save(encode(u, user_state), fpath);
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static Universe load(const std::string& fpath, std::string* const user_state =nullptr)
+       {
+        const MappedFile file(fpath);
+        Reader r{file.bytes().data(), file.bytes().data() + file.size(), fpath};
+        if( file.size()<magic.size() or std::string_view(reinterpret_cast<const char*>(r.p), magic.size())!=magic )
+           {
+            throw std::runtime_error(fpath + " is not a checkpoint");
+           }
+        r.p += magic.size();
+
+        Universe u( r.get<double>() );
+        u.t = r.get<double>();
+        u.m_dt = r.get<double>();
+        u.m_next_id = r.get<std::uint64_t>();
+        const auto collision_mode = r.get<std::uint8_t>();
+        if( collision_mode>static_cast<std::uint8_t>(Universe::CollisionMode::bounce) ) throw std::runtime_error(fpath + " has an invalid collision mode");
+        u.m_collision_mode = static_cast<Universe::CollisionMode>(collision_mode);
+        u.m_Cr = r.get<double>();
+        u.m_neighbors.set_skin( r.get<double>() );
+        u.m_escape_radius = r.get<double>();
+        u.m_escaped_mass = r.get<double>();
+        u.m_escaped_momentum = r.get<Vect>();
+        u.m_bodies.reserve( std::min(static_cast<std::size_t>(r.peek<std::uint64_t>()), file.size()/body_size) );
+        for( auto n=r.get<std::uint64_t>(); n>0; --n ) u.m_bodies.push_back( r.get<Body>() );
+        for( auto n=r.get<std::uint64_t>(); n>0; --n ) u.m_escaped.push_back( r.get<Body>() );
+        const auto user_state_size = static_cast<std::size_t>(r.get<std::uint64_t>());
+        r.require(user_state_size);
+        if( user_state ) user_state->assign(reinterpret_cast<const char*>(r.p), user_state_size);
+        return u;
+       }
+
+ private:
+    static constexpr std::size_t body_size = 8 + 10*8;
+
+    //-----------------------------------------------------------------------
+    template<typename T> static void put(std::vector<char>& buf, const T v)
+       {
+        if constexpr( std::is_same_v<T,Vect> )
+           {
+            put(buf, v.x);
+            put(buf, v.y);
+           }
+        else if constexpr( std::is_same_v<T,Body> )
+           {
+            put(buf, v.i_id);
+            put(buf, v.i_mass);
+            put(buf, v.i_radius);
+            put(buf, v.i_pos);
+            put(buf, v.i_prev_pos);
+            put(buf, v.i_spd);
+            put(buf, v.i_acc);
+           }
+        else
+           {
+            const std::size_t n = buf.size();
+            buf.resize(n + sizeof(T));
+            std::memcpy(buf.data()+n, &v, sizeof(T));
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    struct Reader final
+       {
+        const std::byte* p;
+        const std::byte* end;
+        const std::string& fpath;
+
+        void require(const std::size_t n) const
+           {
+            if( static_cast<std::size_t>(end-p)<n ) throw std::runtime_error(fpath + " is truncated");
+           }
+
+        template<typename T> [[nodiscard]] T peek() const
+           {
+            require(sizeof(T));
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            return v;
+           }
+
+        template<typename T> [[nodiscard]] T get()
+           {
+            if constexpr( std::is_same_v<T,Vect> )
+               {
+                const double x = get<double>();
+                const double y = get<double>();
+                return Vect{x,y};
+               }
+            else if constexpr( std::is_same_v<T,Body> )
+               {
+                const auto id = get<std::uint64_t>();
+                const double mass = get<double>();
+                Body body(mass, Vect{}, Vect{}, id);
+                body.i_radius = get<double>();
+                body.i_pos = get<Vect>();
+                body.i_prev_pos = get<Vect>();
+                body.i_spd = get<Vect>();
+                body.i_acc = get<Vect>();
+                return body;
+               }
+            else
+               {
+                const T v = peek<T>();
+                p += sizeof(T);
+                return v;
+               }
+           }
+       };
+};
+
+
+////////////////////////////////////////////////////////////////////////
+// Writes the checkpoints in background: the caller pays just the copy
+// of the state in memory
+class CheckpointWriter final
+{
+ private:
+    std::string m_fpath;
+    std::exception_ptr m_error; // Of the last background write
+    std::jthread m_thread;
+
+ public:
+    explicit CheckpointWriter(std::string fpath) noexcept
+      : m_fpath(std::move(fpath))
+       {}
+
+    [[nodiscard]] const std::string& path() const noexcept { return m_fpath; }
+
+    void write(const Universe& u, const std::string_view user_state ={})
+       {
+        wait(); // The previous should be done by now
+        m_thread = std::jthread([this, encoded=Checkpoint::encode(u, user_state)]
+           {
+            try{ Checkpoint::save(encoded, m_fpath); }
+            catch(...) { m_error = std::current_exception(); }
+           });
+       }
+
+    void wait()
+       {
+        if( m_thread.joinable() ) m_thread.join();
+        if( m_error ) std::rethrow_exception(std::exchange(m_error, nullptr));
+       }
+};
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <filesystem> // std::filesystem::*
+static ut::suite<"Checkpoint"> checkpoint_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("Checkpoint save and load") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.chk").string();
+    Universe original(1.0);
+    original.set_collision_mode(Universe::CollisionMode::bounce);
+    original.add_body(5000, {400,400}, {0,0})
+            .add_body(200, {200,400}, {0,4})
+            .add_body(300, {700,400}, {0,-2});
+    for( int i=0; i<10; ++i ) original.evolve_verlet(0.1);
+    Checkpoint::save(original, fpath, "user state");
+
+    ut::test("same evolution") = [&]
+       {
+        std::string user_state;
+        Universe restored = Checkpoint::load(fpath, &user_state);
+        ut::expect( user_state=="user state" );
+        ut::expect( restored.collision_mode()==Universe::CollisionMode::bounce );
+        Universe copy = original;
+        for( int i=0; i<10; ++i )
+           {
+            copy.evolve_verlet(0.1);
+            restored.evolve_verlet(0.1);
+           }
+        ut::expect( restored.time()==copy.time() and restored.bodies().size()==copy.bodies().size() );
+        bool same = true;
+        for( std::size_t i=0; i<copy.bodies().size(); ++i )
+           {
+            same = same and restored.bodies()[i].id()==copy.bodies()[i].id()
+                        and restored.bodies()[i].position()==copy.bodies()[i].position()
+                        and restored.bodies()[i].speed()==copy.bodies()[i].speed();
+           }
+        ut::expect( same );
+       };
+
+    ut::test("invalid collision mode") = [&]
+       {
+           {
+            std::fstream f(fpath, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(8 + 4*8); // After magic, G, t, dt, next id
+            f.put('\x7f');
+           }
+        ut::expect( ut::throws([&]{ [[maybe_unused]] const Universe u = Checkpoint::load(fpath); }) );
+       };
+
+    ut::test("truncated") = [&]
+       {
+        std::filesystem::resize_file(fpath, 20);
+        ut::expect( ut::throws([&]{ [[maybe_unused]] const Universe u = Checkpoint::load(fpath); }) );
+       };
+    std::filesystem::remove(fpath);
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
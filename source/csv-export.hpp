@@ -0,0 +1,225 @@
+#pragma once
+//  ---------------------------------------------
+//  Fast text export of samples
+//  ---------------------------------------------
+#include <algorithm> // std::min
+#include <charconv> // std::to_chars
+#include <cstdint> // std::uint32_t
+#include <fstream>
+#include <initializer_list>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sample.hpp" // Sample, SampleSink
+#include "parallel.hpp" // par::*
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace csv //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+enum class Column : std::uint32_t
+{
+    energies  = 1u << 0, // Ek,Eu,E
+    cm        = 1u << 1, // Center of mass
+    positions = 1u << 2, // Of each body
+    speeds    = 1u << 3  // Of each body
+};
+
+//----------------------------------------------------------------------
+class Columns final
+{
+ private:
+    std::uint32_t m_bits = 0;
+
+ public:
+    constexpr Columns(std::initializer_list<Column> lst) noexcept
+       {
+        for( const Column c : lst ) m_bits |= static_cast<std::uint32_t>(c);
+       }
+    [[nodiscard]] constexpr bool contains(const Column c) const noexcept { return (m_bits & static_cast<std::uint32_t>(c))!=0; }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Appends rows to a growing char buffer, numbers in their shortest
+// round-trip representation, locale independent
+class Formatter final
+{
+ private:
+    Columns m_columns;
+    std::vector<char> m_buf;
+    std::size_t m_len = 0;
+
+    static constexpr std::size_t max_number_len = 32;
+
+ public:
+    explicit Formatter(const Columns columns) noexcept
+      : m_columns(columns)
+       {}
+
+    [[nodiscard]] std::string_view text() const noexcept { return {m_buf.data(), m_len}; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_len; }
+    void clear() noexcept { m_len = 0; }
+
+    //-----------------------------------------------------------------------
+    void header()
+       {
+        append("time");
+        if( m_columns.contains(Column::energies) ) append(",Ek,Eu,E");
+        if( m_columns.contains(Column::cm) ) append(",Cm.x,Cm.y");
+        if( m_columns.contains(Column::positions) ) append(",bodies-xy-pos");
+        if( m_columns.contains(Column::speeds) ) append(",bodies-xy-spd");
+        append("\n");
+       }
+
+    //-----------------------------------------------------------------------
+    void row(const Sample& s)
+       {
+        std::size_t per_body = 0;
+        if( m_columns.contains(Column::positions) ) per_body += 2;
+        if( m_columns.contains(Column::speeds) ) per_body += 2;
+        reserve( (6 + per_body*s.bodies.size()) * max_number_len + 1 );
+
+        number(s.time);
+        if( m_columns.contains(Column::energies) )
+           {
+            if( s.has(Sample::has_energies) )
+               {
+                comma(); number(s.Ek);
+                comma(); number(s.Eu);
+                comma(); number(s.Ek + s.Eu);
+               }
+            else append(",,,"); // Not sampled
+           }
+        if( m_columns.contains(Column::cm) )
+           {
+            if( s.has(Sample::has_cm) )
+               {
+                comma(); number(s.Cm.x);
+                comma(); number(s.Cm.y);
+               }
+            else append(",,");
+           }
+        if( m_columns.contains(Column::positions) )
+           {
+            for( const auto& body : s.bodies )
+               {
+                comma(); number(body.position().x);
+                comma(); number(body.position().y);
+               }
+           }
+        if( m_columns.contains(Column::speeds) )
+           {
+            for( const auto& body : s.bodies )
+               {
+                comma(); number(body.speed().x);
+                comma(); number(body.speed().y);
+               }
+           }
+        m_buf[m_len++] = '\n';
+       }
+
+ private:
+    void reserve(const std::size_t n)
+       {
+        if( m_buf.size() < m_len+n ) m_buf.resize(2*(m_len+n));
+       }
+
+    void append(const std::string_view sv)
+       {
+        reserve(sv.size());
+        sv.copy(m_buf.data()+m_len, sv.size());
+        m_len += sv.size();
+       }
+
+    void comma() noexcept { m_buf[m_len++] = ','; }
+
+    void number(const double v) noexcept
+       {// Room already reserved
+        m_len = static_cast<std::size_t>(std::to_chars(m_buf.data()+m_len, m_buf.data()+m_buf.size(), v).ptr - m_buf.data());
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes the samples as they come, in big chunks
+class FileSink final : public SampleSink
+{
+ private:
+    std::ofstream m_file;
+    Formatter m_fmt;
+    static constexpr std::size_t chunk_size = 1u << 20;
+
+ public:
+    explicit FileSink(const std::string& fpath, const Columns columns ={Column::positions})
+      : m_file(fpath, std::ios::out | std::ios::binary)
+      , m_fmt(columns)
+       {
+        if(!m_file.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+        m_fmt.header();
+       }
+
+    ~FileSink() override { flush(); }
+
+    void push(const Sample& s) override
+       {
+        m_fmt.row(s);
+        if( m_fmt.size()>=chunk_size ) flush();
+       }
+
+    void finish() override
+       {
+        flush();
+        m_file.flush();
+       }
+
+ private:
+    void flush()
+       {
+        m_file.write(m_fmt.text().data(), static_cast<std::streamsize>(m_fmt.size()));
+        m_fmt.clear();
+       }
+};
+
+
+//----------------------------------------------------------------------
+// Exports a random access collection of samples (having size() and
+// sample(i)), formatting batches of them in parallel
+template<typename Samples>
+void save(const Samples& samples, const std::string& fpath, const Columns columns ={Column::positions}, const bool parallel =true)
+{
+    std::ofstream f(fpath, std::ios::out | std::ios::binary);
+    if(!f.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+    auto write = [&f](const Formatter& fmt)
+       {
+        f.write(fmt.text().data(), static_cast<std::streamsize>(fmt.size()));
+       };
+
+    const std::size_t k = parallel ? par::max_workers() : 1;
+    std::vector<Formatter> fmts(k, Formatter{columns});
+    fmts[0].header();
+    write(fmts[0]);
+    fmts[0].clear();
+
+    // Bounded memory: each worker formats a slice of a batch
+    const std::size_t n = samples.size();
+    const std::size_t batch_size = 64 * k;
+    for( std::size_t batch_begin=0; batch_begin<n; batch_begin+=batch_size )
+       {
+        const std::size_t batch_end = std::min(n, batch_begin+batch_size);
+        par::for_chunks(batch_end-batch_begin, k, [&](const std::size_t c, const std::size_t b, const std::size_t e)
+           {
+            for( std::size_t i=batch_begin+b; i<batch_begin+e; ++i ) fmts[c].row(samples.sample(i));
+           });
+        for( Formatter& fmt : fmts )
+           {
+            write(fmt);
+            fmt.clear();
+           }
+       }
+}
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
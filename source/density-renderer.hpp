@@ -0,0 +1,138 @@
+#pragma once
+//  ---------------------------------------------
+//  Draws the density of the bodies as an image
+//  ---------------------------------------------
+#include <array>
+#include <algorithm> // std::max, std::max_element
+#include <cmath> // std::log1p
+#include <cstdint> // std::uint32_t, std::uint8_t
+#include <stdexcept> // std::runtime_error
+#include <vector>
+
+#include <SFML/Graphics.hpp> // sf::*
+
+#include "sfml-addons-color.hpp" // sfadd::Color
+#include "universe.hpp" // Universe
+#include "parallel.hpp" // par::*
+
+
+////////////////////////////////////////////////////////////////////////
+// For a huge number of bodies: instead of drawing them one by one, the
+// bodies are counted in each pixel of the view and the counts become the
+// colors of one texture, so the cost of a frame is O(N + pixels)
+// whatever the size of the bodies. The counting is split among threads,
+// each one with its own histogram summed at the end; the counts are
+// mapped to colors with a logarithmic scale, to show both the sparse
+// regions and the dense cores
+class DensityRenderer final : public sf::Drawable
+{
+ private:
+    static constexpr std::size_t min_chunk_bodies = 50'000; // Not worth a thread for less
+    static constexpr std::size_t min_chunk_pixels = 100'000;
+    static constexpr float max_palette_index = 255.0f;
+    std::array<sf::Color,256> m_palette; // Log density → color
+    unsigned int m_width = 0, m_height = 0; // [pixels]
+    std::vector<std::vector<std::uint32_t>> m_histograms; // One for each worker
+    std::vector<std::uint32_t> m_counts; // Bodies in each pixel
+    std::vector<std::uint8_t> m_pixels; // RGBA
+    sf::Texture m_texture;
+    sf::Sprite m_sprite;
+
+ public:
+    DensityRenderer()
+       {
+        // From transparent dark blue to opaque light yellow
+        for( std::size_t i=0; i<m_palette.size(); ++i )
+           {
+            const float k = static_cast<float>(i) / max_palette_index;
+            sfadd::Color col;
+            col.set_hsl({240.0f - 180.0f*k, 1.0f, 0.15f + 0.8f*k});
+            col.a = static_cast<sf::Uint8>(i>0 ? 80.0f + 175.0f*k : 0.0f);
+            m_palette[i] = col;
+           }
+       }
+
+    DensityRenderer(const DensityRenderer&) = delete;
+    DensityRenderer& operator=(const DensityRenderer&) = delete;
+
+    //                                                                   Visible area          Image size [pixels]
+    void update(const std::vector<Universe::Body>& bodies, const sf::FloatRect& view_rect, const unsigned int w, const unsigned int h)
+       {
+        resize(w, h);
+        if( m_counts.empty() or not (view_rect.width>0.0f and view_rect.height>0.0f) ) return;
+
+        // Counting the bodies in each pixel
+        const float kx = static_cast<float>(m_width) / view_rect.width;
+        const float ky = static_cast<float>(m_height) / view_rect.height;
+        const std::size_t workers = par::chunks_count(bodies.size(), min_chunk_bodies);
+        if( m_histograms.size()<workers ) m_histograms.resize(workers);
+        par::for_chunks(bodies.size(), workers, [&](const std::size_t c, const std::size_t b, const std::size_t e)
+           {
+            std::vector<std::uint32_t>& histogram = c==0 ? m_counts : m_histograms[c];
+            histogram.assign(m_counts.size(), 0);
+            for( std::size_t i=b; i<e; ++i )
+               {
+                const float x = (static_cast<float>(bodies[i].position().x) - view_rect.left) * kx;
+                const float y = (static_cast<float>(bodies[i].position().y) - view_rect.top) * ky;
+                if( x>=0.0f and y>=0.0f and x<static_cast<float>(m_width) and y<static_cast<float>(m_height) )
+                   {
+                    ++histogram[ static_cast<std::size_t>(y)*m_width + static_cast<std::size_t>(x) ];
+                   }
+               }
+           });
+
+        // Summing the histograms
+        const std::size_t pixel_workers = par::chunks_count(m_counts.size(), min_chunk_pixels);
+        std::vector<std::uint32_t> chunk_max(pixel_workers, 0);
+        par::for_chunks(m_counts.size(), pixel_workers, [&](const std::size_t c, const std::size_t b, const std::size_t e)
+           {
+            std::uint32_t max_count = 0;
+            for( std::size_t i=b; i<e; ++i )
+               {
+                for( std::size_t t=1; t<workers; ++t ) m_counts[i] += m_histograms[t][i];
+                max_count = std::max(max_count, m_counts[i]);
+               }
+            chunk_max[c] = max_count;
+           });
+
+        // Tone mapping
+        const std::uint32_t max_count = *std::max_element(chunk_max.begin(), chunk_max.end());
+        const float k_log = max_count>0 ? max_palette_index / std::log1p(static_cast<float>(max_count)) : 0.0f;
+        par::for_chunks(m_counts.size(), pixel_workers, [&](const std::size_t, const std::size_t b, const std::size_t e)
+           {
+            for( std::size_t i=b; i<e; ++i )
+               {
+                const sf::Color& col = m_palette[ static_cast<std::size_t>(k_log * std::log1p(static_cast<float>(m_counts[i]))) ];
+                m_pixels[4*i] = col.r;
+                m_pixels[4*i+1] = col.g;
+                m_pixels[4*i+2] = col.b;
+                m_pixels[4*i+3] = col.a;
+               }
+           });
+
+        m_texture.update(m_pixels.data());
+        m_sprite.setPosition(view_rect.left, view_rect.top);
+        m_sprite.setScale(view_rect.width / static_cast<float>(m_width), view_rect.height / static_cast<float>(m_height));
+       }
+
+ private:
+    void resize(const unsigned int w, const unsigned int h)
+       {
+        if( w==m_width and h==m_height ) return;
+        m_width = w;
+        m_height = h;
+        const std::size_t n = static_cast<std::size_t>(w) * h;
+        m_counts.assign(n, 0);
+        m_pixels.assign(4*n, 0);
+        if( n>0 )
+           {
+            if( not m_texture.create(w, h) ) throw std::runtime_error("Unable to create the density texture");
+            m_sprite.setTexture(m_texture, true);
+           }
+       }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+       {
+        if( not m_counts.empty() ) target.draw(m_sprite, states);
+       }
+};
@@ -0,0 +1,68 @@
+#pragma once
+//  ---------------------------------------------
+//  Monitoring the conserved quantities
+//  ---------------------------------------------
+//  The totals come from the last step of the universe, so checking them
+//  costs O(1) unless the bodies were changed afterwards (collisions,
+//  escapes); a cadence limits the records anyway
+#include <algorithm> // std::max
+#include <cmath> // std::abs
+#include <vector>
+
+#include "universe.hpp" // Universe
+#include "sampling.hpp" // sampling::Cadence
+
+
+////////////////////////////////////////////////////////////////////////
+class Diagnostics final
+{
+ public:
+    using Vect = Universe::Vect;
+
+    struct Record final
+       {
+        double time;
+        double Ek, Eu; // Kinetic and gravitational energy
+        Vect P; // Momentum, including the escaped bodies
+        Vect Cm; // Center of mass
+        [[nodiscard]] double E() const noexcept { return Ek + Eu; }
+       };
+
+ private:
+    sampling::Cadence m_cadence;
+    std::vector<Record> m_records;
+    double m_max_energy_drift = 0.0; // Relative to the first record
+
+ public:
+    explicit Diagnostics(const sampling::Cadence cadence =sampling::Cadence::every_steps(100)) noexcept
+      : m_cadence(cadence)
+       {}
+
+    void set_cadence(const sampling::Cadence cadence) noexcept { m_cadence = cadence; }
+
+    //                                                         Steps done         Time before the step
+    void observe(const Universe& universe, const std::size_t step, const double t_prev)
+       {
+        if( m_cadence.is_due(step, t_prev, universe.time()) ) record(universe);
+       }
+
+    void record(const Universe& universe)
+       {
+        m_records.push_back({ universe.time(),
+                              universe.kinetic_energy(),
+                              universe.gravitational_energy(),
+                              universe.momentum() + universe.escaped_momentum(),
+                              universe.center_of_mass() });
+        const double E0 = m_records.front().E();
+        if( E0!=0.0 ) m_max_energy_drift = std::max(m_max_energy_drift, std::abs((m_records.back().E() - E0) / E0));
+       }
+
+    void clear() noexcept
+       {
+        m_records.clear();
+        m_max_energy_drift = 0.0;
+       }
+
+    [[nodiscard]] const std::vector<Record>& records() const noexcept { return m_records; }
+    [[nodiscard]] double max_energy_drift() const noexcept { return m_max_energy_drift; }
+};
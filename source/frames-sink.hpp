@@ -0,0 +1,190 @@
+#pragma once
+//  ---------------------------------------------
+//  Offscreen rendering of the samples as a stream of images
+//  ---------------------------------------------
+//  Pure software, no display or graphic card needed. The frames are
+//  binary PPM images one after another, so the output can be piped
+//  to a video encoder, for example:
+//    n-body-batch ... --frames - | ffmpeg -f image2pipe -c:v ppm -i - out.mp4
+#include <algorithm> // std::clamp, std::max, std::min
+#include <array>
+#include <cmath> // std::floor, std::ceil, std::sqrt
+#include <cstdint> // std::uint8_t
+#include <cstdio> // std::FILE, std::fopen, std::fwrite
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <vector>
+
+#include "sample.hpp" // Sample, SampleSink
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace frames //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+struct Rgb final { std::uint8_t r, g, b; };
+
+// The visible portion of the universe
+struct Window final
+{
+    double left, top, width, height;
+
+    // Encloses the bodies with a margin, keeping the aspect ratio of the image
+    [[nodiscard]] static Window around(const std::vector<Universe::Body>& bodies, const double aspect_ratio)
+       {
+        double x0=0.0, y0=0.0, x1=1.0, y1=1.0;
+        if( not bodies.empty() )
+           {
+            x0 = x1 = bodies.front().position().x;
+            y0 = y1 = bodies.front().position().y;
+           }
+        for( const auto& body : bodies )
+           {
+            x0 = std::min(x0, body.position().x - body.radius());
+            y0 = std::min(y0, body.position().y - body.radius());
+            x1 = std::max(x1, body.position().x + body.radius());
+            y1 = std::max(y1, body.position().y + body.radius());
+           }
+        double w = 1.2 * std::max(x1-x0, 1.0);
+        double h = 1.2 * std::max(y1-y0, 1.0);
+        if( w < h*aspect_ratio ) w = h*aspect_ratio;
+        else h = w/aspect_ratio;
+        return { (x0+x1-w)/2.0, (y0+y1-h)/2.0, w, h };
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// An RGB image where to draw filled circles
+class Raster final
+{
+ private:
+    std::size_t m_width, m_height;
+    std::vector<std::uint8_t> m_pixels; // Row after row, 3 bytes each
+
+ public:
+    Raster(const std::size_t w, const std::size_t h)
+      : m_width(w)
+      , m_height(h)
+      , m_pixels(3*w*h)
+       {}
+
+    [[nodiscard]] std::size_t width() const noexcept { return m_width; }
+    [[nodiscard]] std::size_t height() const noexcept { return m_height; }
+    [[nodiscard]] const std::vector<std::uint8_t>& pixels() const noexcept { return m_pixels; }
+
+    void clear(const Rgb col) noexcept
+       {
+        for( std::size_t i=0; i<m_pixels.size(); i+=3 ) set(i, col);
+       }
+
+    // Coordinates in pixels, at least one pixel is drawn
+    void fill_circle(const double cx, const double cy, const double r, const Rgb col) noexcept
+       {
+        const double y_first = std::max(std::ceil(cy - r - 0.5), 0.0);
+        const double y_last = std::min(std::floor(cy + r - 0.5), static_cast<double>(m_height) - 1.0);
+        if( y_last<y_first )
+           {// Smaller than a pixel
+            plot(cx, cy, col);
+            return;
+           }
+        for( double y=y_first; y<=y_last; y+=1.0 )
+           {// Pixels whose center is inside
+            const double dy = y + 0.5 - cy;
+            const double half = std::sqrt(std::max(r*r - dy*dy, 0.0));
+            const double x_first = std::max(std::ceil(cx - half - 0.5), 0.0);
+            const double x_last = std::min(std::floor(cx + half - 0.5), static_cast<double>(m_width) - 1.0);
+            const std::size_t row = static_cast<std::size_t>(y) * m_width;
+            for( double x=x_first; x<=x_last; x+=1.0 ) set(3*(row + static_cast<std::size_t>(x)), col);
+           }
+       }
+
+ private:
+    void set(const std::size_t i, const Rgb col) noexcept
+       {
+        m_pixels[i] = col.r;
+        m_pixels[i+1] = col.g;
+        m_pixels[i+2] = col.b;
+       }
+
+    void plot(const double x, const double y, const Rgb col) noexcept
+       {
+        if( x<0.0 or y<0.0 or x>=static_cast<double>(m_width) or y>=static_cast<double>(m_height) ) return;
+        set(3*(static_cast<std::size_t>(y)*m_width + static_cast<std::size_t>(x)), col);
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders the samples having bodies. Slow for the simulation thread,
+// meant to be wrapped in an AsyncSink
+class Sink final : public SampleSink
+{
+ private:
+    std::FILE* m_file;
+    bool m_own_file;
+    Window m_window;
+    Raster m_raster;
+    std::array<Rgb,256> m_palette; // Mass → color
+    double m_palette_k; // Mass to palette index
+    std::string m_header;
+    bool m_write_failed = false; // Reported at the end, the pushes may be on another thread
+
+ public:
+    //                   File path ("-" for standard output)                          Image size [pixels]                                       Mass that gets the brightest color
+    Sink(const std::string& fpath, const Window& window, const std::size_t w, const std::size_t h, const double max_mass =10000.0)
+      : m_file(fpath=="-" ? stdout : std::fopen(fpath.c_str(), "wb"))
+      , m_own_file(fpath!="-")
+      , m_window(window)
+      , m_raster(w, h)
+      , m_palette_k(255.0 / max_mass)
+      , m_header("P6\n" + std::to_string(w) + ' ' + std::to_string(h) + "\n255\n")
+       {
+        if( not m_file ) throw std::runtime_error("Unable to open file " + fpath);
+        // From dark yellow to white, linearly in RGB: the interactive view
+        // varies instead the HSL luminance of sfadd::Color, not available
+        // without SFML, so the tones are not the same
+        for( std::size_t i=0; i<m_palette.size(); ++i )
+           {
+            const double k = static_cast<double>(i) / 255.0;
+            auto lerp = [k](const double from) noexcept { return static_cast<std::uint8_t>(from + k*(255.0-from)); };
+            m_palette[i] = { lerp(78.0), lerp(72.0), lerp(8.0) };
+           }
+       }
+
+    ~Sink() override
+       {
+        if( m_own_file ) std::fclose(m_file);
+       }
+
+    Sink(const Sink&) = delete;
+    Sink& operator=(const Sink&) = delete;
+
+    void push(const Sample& s) override
+       {
+        if( not s.has(Sample::has_bodies) ) return;
+        const double kx = static_cast<double>(m_raster.width()) / m_window.width;
+        const double ky = static_cast<double>(m_raster.height()) / m_window.height;
+        m_raster.clear({0,0,0});
+        for( const auto& body : s.bodies )
+           {
+            const auto idx = static_cast<std::size_t>(std::clamp(m_palette_k * body.mass(), 0.0, 255.0));
+            m_raster.fill_circle( (body.position().x - m_window.left) * kx,
+                                  (body.position().y - m_window.top) * ky,
+                                  body.radius() * kx,
+                                  m_palette[idx] );
+           }
+        if( std::fwrite(m_header.data(), 1, m_header.size(), m_file)!=m_header.size() or
+            std::fwrite(m_raster.pixels().data(), 1, m_raster.pixels().size(), m_file)!=m_raster.pixels().size() )
+           {
+            m_write_failed = true;
+           }
+       }
+
+    void finish() override
+       {
+        if( std::fflush(m_file)!=0 or m_write_failed ) throw std::runtime_error("Unable to write the frames");
+       }
+};
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
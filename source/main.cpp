@@ -1,6 +1,5 @@
 #include <array>
 #include <algorithm> // std::clamp
-#include <chrono> // std::chrono::*
 #include <iostream>
 #include <format>
 
@@ -9,6 +8,11 @@
 #include "sfml-addons.hpp" // sfadd::*
 #include "sfml-addons-color.hpp" // sfadd::Color
 #include "universe.hpp" // Universe
+#include "bodies-renderer.hpp" // BodiesRenderer
+#include "trails-renderer.hpp" // TrailsRenderer
+#include "density-renderer.hpp" // DensityRenderer
+#include "physics-thread.hpp" // PhysicsThread, Snapshot, Command
+#include "scenarios.hpp" // scenarios::*
 
 
 //----------------------------------------------------------------------
@@ -21,69 +25,45 @@ void draw(sf::RenderWindow& window, const Universe::Vect& point)
 }
 
 //----------------------------------------------------------------------
-void draw(sf::RenderWindow& window, const Universe::Body& body)
-{
-    auto get_body_color = [](const double mass) noexcept -> sf::Color
-       {
-        sfadd::Color col{78,72,8};
-        col.lum_incr( static_cast<float>(mass)/10000.0f );
-        return col;
-       };
-
-    sf::CircleShape shape( static_cast<float>(body.radius()) );
-    const float r_half = shape.getRadius()/2.0f;
-    shape.setOrigin(r_half, r_half);
-    shape.setFillColor( get_body_color(body.mass()) );
-    shape.setPosition( static_cast<float>(body.position().x),
-                       static_cast<float>(body.position().y) );
-    window.draw(shape);
-}
-
-//----------------------------------------------------------------------
-void draw(sf::RenderWindow& window, const Universe& universe)
+void draw(sf::RenderWindow& window, const sfadd::View& view, const Snapshot& snapshot, BodiesRenderer& renderer)
 {
     // Center of mass
-    draw(window, universe.center_of_mass());
+    draw(window, snapshot.Cm);
 
-    // Bodies
-    for( const auto& body : universe.bodies() )
-       {
-        draw(window, body);
-       }
+    // Bodies, between the last two steps
+    renderer.update(snapshot.bodies, view.rect(), view.pixel_size(), snapshot.interpolation_at(Snapshot::clock::now()));
+    window.draw(renderer);
 }
 
 //----------------------------------------------------------------------
-Universe setup_small_around_big()
+void draw(sf::RenderWindow& window, const sfadd::View& view, const Snapshot& snapshot, DensityRenderer& renderer)
 {
-    Universe universe(1.0); // Our universe: 6.67408E-11 m³/kg s²
-    // Adding bodies (mass, initial position and speed)
-    universe.add_body(5000, {400,400}, {0,0})
-            .add_body(200, {200,400}, {0,4})
-            .add_body(300, {700,400}, {0,-2})
-            .add_body(200, {400,500}, {10,0})
-            .add_body(500, {400,300}, {-5,0});
-    return universe;
-}
+    renderer.update(snapshot.bodies, view.rect(), window.getSize().x, window.getSize().y);
+    window.draw(renderer);
 
-//----------------------------------------------------------------------
-Universe setup_coll_test()
-{
-    Universe universe(0.0);
-    universe.add_body(40000, {300,400}, {2,1})
-            .add_body(20000, {500,396}, {-2,1});
-    return universe;
+    // Center of mass
+    draw(window, snapshot.Cm);
 }
 
 
 //----------------------------------------------------------------------
 int main()
 {
-    // Creating a universe with a certain gravitational constant
-    Universe universe = setup_small_around_big();
-    //Universe universe = setup_coll_test();
+    // Creating a universe with a certain gravitational constant,
+    // evolving on its own thread
+    const double dt = 0.05; // Time step
+    double k_time = 10.0; // Simulated time per second
+    PhysicsThread physics( scenarios::small_around_big(), dt, k_time );
+    //PhysicsThread physics( scenarios::coll_test(), dt, k_time );
 
     sf::RenderWindow window(sf::VideoMode(800, 800), "n-body");
     sfadd::View view{ window };
+    BodiesRenderer renderer;
+    TrailsRenderer trails;
+    bool show_trails = true;
+    double trails_time = -1.0; // Of the last recorded snapshot
+    DensityRenderer density;
+    bool show_density = false; // Instead of the single bodies
 
     sf::Text text;
     sf::Font font;
@@ -104,12 +84,6 @@ int main()
     //dbg_text.setFont(font);
     //dbg_text.setFillColor(sf::Color::Yellow);
 
-    using clock = std::chrono::high_resolution_clock;
-    using sec = std::chrono::duration<double>;
-    //using ms = std::chrono::duration<double, std::milli>;
-    auto before = clock::now();
-    const double k_time = 10.0;
-
     while( window.isOpen() )
        {
         sf::Event event;
@@ -125,8 +99,9 @@ int main()
                     if( event.mouseButton.button==sf::Mouse::Left )
                        {
                         const sf::Vector2f p = window.mapPixelToCoords({event.mouseButton.x, event.mouseButton.y});
-                        universe.add_body(200, {p.x+20, p.y}, {8.0f,0});
-                        universe.add_body(200, {p.x-20, p.y}, {-8.0f,0});
+                        // Just lost if the physics thread is too far behind to take them
+                        [[maybe_unused]] const bool posted = physics.post({Command::Kind::add_body, 200, {p.x+20, p.y}, {8.0f,0}})
+                                                         and physics.post({Command::Kind::add_body, 200, {p.x-20, p.y}, {-8.0f,0}});
                        }
                     else if( event.mouseButton.button==sf::Mouse::Middle )
                        {
@@ -162,6 +137,29 @@ int main()
                        {
                         window.close();
                        }
+                    else if( event.key.code==sf::Keyboard::Add or event.key.code==sf::Keyboard::Equal )
+                       {
+                        if( physics.post({Command::Kind::set_time_warp, 0.0, {}, {}, 2.0*k_time}) ) k_time *= 2.0;
+                       }
+                    else if( event.key.code==sf::Keyboard::Subtract or event.key.code==sf::Keyboard::Hyphen )
+                       {
+                        if( physics.post({Command::Kind::set_time_warp, 0.0, {}, {}, 0.5*k_time}) ) k_time /= 2.0;
+                       }
+                    else if( event.key.code==sf::Keyboard::T )
+                       {
+                        show_trails = not show_trails;
+                        trails.clear();
+                       }
+                    else if( event.key.code==sf::Keyboard::D )
+                       {
+                        show_density = not show_density;
+                       }
+                    else if( event.key.code==sf::Keyboard::P or event.key.code==sf::Keyboard::R )
+                       {// A cluster at the mouse cursor
+                        const sf::Vector2f p = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+                        [[maybe_unused]] const bool posted = event.key.code==sf::Keyboard::P ? physics.post({Command::Kind::add_plummer, 2000, {p.x, p.y}, {}, 0.0, 2000, 100.0})
+                                                                                              : physics.post({Command::Kind::add_disk, 6000, {p.x, p.y}, {}, 0.0, 3000, 400.0});
+                       }
                     break;
 
                 case sf::Event::Closed:
@@ -173,15 +171,17 @@ int main()
                }
            }
 
-        const sec duration = clock::now() - before;
-        before = clock::now();
-        universe.evolve_verlet( k_time * duration.count() );
-        universe.handle_collisions();
+        const Snapshot& snapshot = physics.latest();
+        if( show_trails and snapshot.time>trails_time )
+           {// A new state
+            trails.record(snapshot.bodies);
+            trails_time = snapshot.time;
+           }
 
         window.clear();
         view.draw_grid(100,100,sf::Color{50,50,50});
 
-        text.setString(std::format("E={:.1f}  dt={:.1f}ms  t={:.0f}s", universe.total_energy(), 1E3*duration.count(), universe.time()));
+        text.setString(std::format("E={:.1f}  dt={:.3f}s  t={:.0f}s  warp x{:.1f} (x{:.1f} requested, +/- to change, T for trails, D for density, P/R for a cluster)", snapshot.E, snapshot.dt, snapshot.time, snapshot.time_warp, snapshot.k_time));
         text.setPosition( window.mapPixelToCoords({0,0}) );
         //text.setCharacterSize(14);
 
@@ -189,7 +189,9 @@ int main()
         //dbg_text.setPosition( window.mapPixelToCoords({0,20}) );
         //window.draw(dbg_text);
 
-        draw(window, universe);
+        if( show_trails ) window.draw(trails);
+        if( show_density ) draw(window, view, snapshot, density);
+        else draw(window, view, snapshot, renderer);
 
         window.draw(text);
         window.display();
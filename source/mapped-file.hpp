@@ -0,0 +1,103 @@
+#pragma once
+//  ---------------------------------------------
+//  Read only memory mapped file
+//  ---------------------------------------------
+#include <cstddef> // std::size_t, std::byte
+#include <span>
+#include <stdexcept> // std::runtime_error
+#include <string>
+
+#if defined(_WIN32) or defined(_WIN64)
+  #include <windows.h>
+#else
+  #include <fcntl.h> // open
+  #include <sys/mman.h> // mmap, munmap
+  #include <sys/stat.h> // fstat
+  #include <unistd.h> // close
+#endif
+
+
+////////////////////////////////////////////////////////////////////////
+class MappedFile final
+{
+ private:
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+  #if defined(_WIN32) or defined(_WIN64)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+  #endif
+
+ public:
+    explicit MappedFile(const std::string& fpath)
+       {
+      #if defined(_WIN32) or defined(_WIN64)
+        m_file = ::CreateFileA(fpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if( m_file==INVALID_HANDLE_VALUE ) throw std::runtime_error("Unable to open file " + fpath);
+        LARGE_INTEGER siz;
+        if( not ::GetFileSizeEx(m_file, &siz) )
+           {
+            close();
+            throw std::runtime_error("Unable to get size of " + fpath);
+           }
+        m_size = static_cast<std::size_t>(siz.QuadPart);
+        if( m_size>0 )
+           {
+            m_mapping = ::CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if( m_mapping ) m_data = static_cast<const std::byte*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            if( not m_data )
+               {
+                close();
+                throw std::runtime_error("Unable to map file " + fpath);
+               }
+           }
+      #else
+        const int fd = ::open(fpath.c_str(), O_RDONLY);
+        if( fd<0 ) throw std::runtime_error("Unable to open file " + fpath);
+        struct stat st{};
+        if( ::fstat(fd, &st)!=0 )
+           {
+            ::close(fd);
+            throw std::runtime_error("Unable to get size of " + fpath);
+           }
+        m_size = static_cast<std::size_t>(st.st_size);
+        if( m_size>0 )
+           {
+            void* const p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if( p==MAP_FAILED )
+               {
+                ::close(fd);
+                throw std::runtime_error("Unable to map file " + fpath);
+               }
+            m_data = static_cast<const std::byte*>(p);
+           }
+        ::close(fd); // The mapping stays valid
+      #endif
+       }
+
+    ~MappedFile() noexcept
+       {
+        close();
+       }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::span<const std::byte> bytes() const noexcept { return {m_data, m_size}; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+ private:
+    void close() noexcept
+       {
+      #if defined(_WIN32) or defined(_WIN64)
+        if( m_data ) ::UnmapViewOfFile(m_data);
+        if( m_mapping ) ::CloseHandle(m_mapping);
+        if( m_file!=INVALID_HANDLE_VALUE ) ::CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+      #else
+        if( m_data ) ::munmap(const_cast<std::byte*>(m_data), m_size);
+      #endif
+        m_data = nullptr;
+       }
+};
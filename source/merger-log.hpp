@@ -0,0 +1,258 @@
+#pragma once
+//  ---------------------------------------------
+//  Binary log of the mergers of a N-body model
+//  ---------------------------------------------
+//  File layout (native endianness):
+//    header  "NBMERGE1" u32:record size
+//    records f64:time u64:survivor index (all ones if escaped) u64:survivor id u64:absorbed id
+//            f64:survivor mass f64:absorbed mass f64:impact speed
+#include <array>
+#include <atomic>
+#include <bit> // std::bit_ceil
+#include <cstdint> // std::uint32_t, std::uint64_t
+#include <cstring> // std::memcpy
+#include <fstream>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <thread> // std::jthread
+#include <vector>
+
+#include "universe.hpp" // Universe::Merger
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace mergers //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+inline constexpr std::string_view magic{"NBMERGE1"};
+inline constexpr std::uint32_t record_size = 7*8;
+
+//----------------------------------------------------------------------
+inline void encode(const Universe::Merger& m, char* buf) noexcept
+{
+    auto put = [&buf](const auto v) noexcept
+       {
+        std::memcpy(buf, &v, sizeof(v));
+        buf += sizeof(v);
+       };
+    put(m.time);
+    put(static_cast<std::uint64_t>(m.survivor_index));
+    put(m.survivor_id);
+    put(m.absorbed_id);
+    put(m.survivor_mass);
+    put(m.absorbed_mass);
+    put(m.impact_speed);
+}
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline Universe::Merger decode(const char* buf) noexcept
+{
+    auto get = [&buf]<typename T>(T& v) noexcept
+       {
+        std::memcpy(&v, buf, sizeof(v));
+        buf += sizeof(v);
+       };
+    Universe::Merger m{};
+    std::uint64_t idx = 0;
+    get(m.time);
+    get(idx);
+    m.survivor_index = static_cast<std::size_t>(idx);
+    get(m.survivor_id);
+    get(m.absorbed_id);
+    get(m.survivor_mass);
+    get(m.absorbed_mass);
+    get(m.impact_speed);
+    return m;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Collects the mergers in a ring buffer that a dedicated thread flushes
+// to file, so the step loop just copies the events and goes on.
+// A single thread is expected to push. The write errors are reported
+// by finish()
+class Log final
+{
+ private:
+    std::string m_fpath;
+    std::ofstream m_file;
+    std::vector<Universe::Merger> m_ring;
+    std::size_t m_mask; // Capacity-1
+    std::atomic<std::size_t> m_head{0}; // Next slot to write (producer)
+    std::atomic<std::size_t> m_tail{0}; // Next slot to flush (consumer)
+    std::atomic<std::uint32_t> m_signal{0}; // Wakes up the writer
+    std::atomic<bool> m_closing{false};
+    std::atomic<bool> m_write_failed{false};
+    std::jthread m_writer; // Declared last, so it stops before the rest is destroyed
+
+ public:
+    explicit Log(const std::string& fpath, const std::size_t capacity =4096)
+      : m_fpath(fpath)
+      , m_file(fpath, std::ios::out | std::ios::binary)
+      , m_ring(std::bit_ceil(capacity<2 ? std::size_t{2} : capacity))
+      , m_mask(m_ring.size()-1)
+       {
+        if(!m_file.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+        m_file.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+        m_file.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+        if(!m_file) throw std::runtime_error("Unable to write " + fpath);
+        m_writer = std::jthread([this]{ flush_loop(); });
+       }
+
+    ~Log()
+       {
+        stop_writer();
+       }
+
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+
+    //-----------------------------------------------------------------------
+    void push(const Universe::Merger& merger)
+       {
+        enqueue(merger);
+        wake_writer();
+       }
+
+    //-----------------------------------------------------------------------
+    void push(const std::vector<Universe::Merger>& mergers)
+       {
+        if( mergers.empty() ) return;
+        for( const auto& merger : mergers ) enqueue(merger);
+        wake_writer();
+       }
+
+    //-----------------------------------------------------------------------
+    // Writes the pending mergers, no more can be pushed
+    void finish()
+       {
+        stop_writer();
+        if( m_write_failed.load(std::memory_order_acquire) ) throw std::runtime_error("Unable to write " + m_fpath);
+       }
+
+ private:
+    void enqueue(const Universe::Merger& merger)
+       {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        while( head - m_tail.load(std::memory_order_acquire) > m_mask )
+           {// Full: should be rare with a proper capacity
+            wake_writer();
+            std::this_thread::yield();
+           }
+        m_ring[head & m_mask] = merger;
+        m_head.store(head+1, std::memory_order_release);
+       }
+
+    void stop_writer() noexcept
+       {
+        if( not m_writer.joinable() ) return;
+        m_closing.store(true, std::memory_order_release);
+        wake_writer();
+        m_writer.join();
+       }
+
+    void wake_writer() noexcept
+       {
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_one();
+       }
+
+    //-----------------------------------------------------------------------
+    void flush_loop()
+       {
+        std::vector<char> buf;
+        while( true )
+           {
+            const std::uint32_t signal = m_signal.load(std::memory_order_acquire);
+            const bool closing = m_closing.load(std::memory_order_acquire);
+            const std::size_t head = m_head.load(std::memory_order_acquire);
+            std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            if( tail!=head )
+               {
+                buf.resize((head-tail) * record_size);
+                for( char* p=buf.data(); tail!=head; ++tail, p+=record_size )
+                   {
+                    encode(m_ring[tail & m_mask], p);
+                   }
+                m_tail.store(tail, std::memory_order_release);
+                if( not m_file.write(buf.data(), static_cast<std::streamsize>(buf.size())) ) m_write_failed.store(true, std::memory_order_release);
+               }
+            else if( closing )
+               {
+                break;
+               }
+            else
+               {
+                m_signal.wait(signal, std::memory_order_acquire);
+               }
+           }
+        if( not m_file.flush() ) m_write_failed.store(true, std::memory_order_release);
+       }
+};
+
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline std::vector<Universe::Merger> read_file(const std::string& fpath)
+{
+    std::ifstream f(fpath, std::ios::in | std::ios::binary);
+    if(!f.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+
+    std::array<char, magic.size()> file_magic{};
+    std::uint32_t file_record_size = 0;
+    f.read(file_magic.data(), file_magic.size());
+    f.read(reinterpret_cast<char*>(&file_record_size), sizeof(file_record_size));
+    if( not f or std::string_view(file_magic.data(), file_magic.size())!=magic or file_record_size!=record_size )
+       {
+        throw std::runtime_error(fpath + " is not a mergers log");
+       }
+
+    std::vector<Universe::Merger> mergers;
+    std::array<char, record_size> buf;
+    while( f.read(buf.data(), buf.size()) )
+       {
+        mergers.push_back( decode(buf.data()) );
+       }
+    if( f.gcount()>0 ) throw std::runtime_error(fpath + " ends with a truncated record");
+    return mergers;
+}
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <filesystem> // std::filesystem::*
+static ut::suite<"mergers"> mergers_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("mergers::Log") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.mrg").string();
+       {
+        mergers::Log log(fpath, 4);
+        for( std::uint64_t id=1; id<=10; ++id ) log.push(Universe::Merger{0.5*static_cast<double>(id), 0, id, id+100, 2.0, 1.0, 3.0});
+        log.finish();
+       }
+    const auto mergers = mergers::read_file(fpath);
+    ut::expect( mergers.size()==10u and mergers.back().absorbed_id==110u and mergers.back().time==5.0 );
+
+    std::filesystem::resize_file(fpath, std::filesystem::file_size(fpath) - 1);
+    ut::expect( ut::throws([&]{ [[maybe_unused]] const auto m = mergers::read_file(fpath); }) ) << "truncated record";
+    std::filesystem::remove(fpath);
+
+    if( std::filesystem::exists("/dev/full") )
+       {
+        mergers::Log log("/dev/full");
+        log.push(Universe::Merger{});
+        ut::expect( ut::throws([&]{ log.finish(); }) ) << "disk full";
+       }
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
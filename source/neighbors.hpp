@@ -0,0 +1,292 @@
+#pragma once
+//  ---------------------------------------------
+//  Verlet neighbor lists of collision candidates
+//  ---------------------------------------------
+#include <vector>
+#include <span>
+#include <utility> // std::pair
+#include <numeric> // std::iota, std::partial_sum
+#include <algorithm> // std::ranges::sort, std::ranges::inplace_merge, std::ranges::lower_bound, std::min, std::max
+#include "math-utilities.hpp" // math::*
+#include "body.hpp" // SphericalBody
+
+
+////////////////////////////////////////////////////////////////////////
+// Holds for each body the following ones that are closer than the sum
+// of radii plus a skin distance. The lists stay valid until a body
+// moves more than half the skin from where they were built, so the
+// broad phase is paid once every many steps.
+template<class Vect> class NeighborList final
+{
+    using Body = SphericalBody<Vect>;
+
+ private:
+    double m_skin; // [<space>] Extra distance of candidates
+    bool m_valid = false;
+    std::vector<Vect> m_ref_pos; // Positions when built
+    std::vector<std::size_t> m_first; // Where the list of each body begins in m_others
+    std::vector<std::size_t> m_others; // Candidates (always following in bodies vector)
+    std::vector<std::size_t> m_order; // Bodies sorted by x
+    std::vector<double> m_reach; // Radius plus last step sweep
+    double m_max_reach = 0.0;
+    std::vector<std::pair<std::size_t,std::size_t>> m_pairs; // Sorted pairs of the lists
+    std::vector<std::pair<std::size_t,std::size_t>> m_new_pairs; // Found while appending
+    std::vector<std::size_t> m_fill; // Insertion points while building
+
+ public:
+    explicit NeighborList(const double skin =10.0) noexcept
+      : m_skin(skin)
+       {}
+
+    [[nodiscard]] double skin() const noexcept { return m_skin; }
+    void set_skin(const double skin) noexcept
+       {
+        m_skin = skin;
+        invalidate();
+       }
+
+    // To be called when bodies are removed or resized
+    void invalidate() noexcept { m_valid = false; }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool needs_rebuild(const std::vector<Body>& bodies) const noexcept
+       {
+        return not m_valid or m_ref_pos.size()!=bodies.size() or moved_too_far(bodies);
+       }
+
+    //-----------------------------------------------------------------------
+    // The bodies appended since the last update are added all at once, so
+    // adding them one by one doesn't lay out the lists each time
+    [[maybe_unused]] bool update(const std::vector<Body>& bodies)
+       {
+        if( m_valid and m_ref_pos.size()<bodies.size() and not moved_too_far(bodies) )
+           {
+            append(bodies, m_ref_pos.size());
+            return false;
+           }
+        if( not needs_rebuild(bodies) ) return false;
+        rebuild(bodies);
+        return true;
+       }
+
+    //-----------------------------------------------------------------------
+    void rebuild(const std::vector<Body>& bodies)
+       {
+        const std::size_t n = bodies.size();
+        m_ref_pos.resize(n);
+        m_reach.resize(n);
+        m_max_reach = 0.0;
+        take_references(bodies, 0);
+
+        // Sweep and prune along x
+        m_order.resize(n);
+        std::iota(m_order.begin(), m_order.end(), std::size_t{0});
+        std::ranges::sort(m_order, {}, [this](const std::size_t i) noexcept { return m_ref_pos[i].x; });
+
+        // The pairs (i<j)
+        m_pairs.clear();
+        for( std::size_t a=0; a<n; ++a )
+           {
+            const std::size_t i = m_order[a];
+            const double x_max = m_ref_pos[i].x + m_reach[i] + m_max_reach + m_skin;
+            for( std::size_t b=a+1; b<n and m_ref_pos[m_order[b]].x<=x_max; ++b )
+               {
+                const std::size_t j = m_order[b];
+                if( are_candidates(i, j) ) m_pairs.emplace_back(std::min(i,j), std::max(i,j));
+               }
+           }
+        // Lists sorted by index: the order doesn't depend on when they're built
+        std::ranges::sort(m_pairs);
+        lay_out(n);
+        m_valid = true;
+       }
+
+    //-----------------------------------------------------------------------
+    // To be called when bodies are appended from first_new on: just their
+    // candidates are searched, the existing pairs stay as they are.
+    // The others haven't moved more than half the skin from their
+    // references, the new ones are where their references are taken now,
+    // so the lists remain valid for all
+    void append(const std::vector<Body>& bodies, const std::size_t first_new)
+       {
+        if( not m_valid or m_ref_pos.size()!=first_new )
+           {// Will be rebuilt anyway
+            m_valid = false;
+            return;
+           }
+        const std::size_t n = bodies.size();
+        m_ref_pos.resize(n);
+        m_reach.resize(n);
+        take_references(bodies, first_new);
+
+        // Merging the new bodies in the x order
+        auto x_of = [this](const std::size_t i) noexcept { return m_ref_pos[i].x; };
+        m_order.resize(n);
+        const auto new_begin = m_order.begin() + static_cast<std::ptrdiff_t>(first_new);
+        std::iota(new_begin, m_order.end(), first_new);
+        std::ranges::sort(new_begin, m_order.end(), {}, x_of);
+        std::ranges::inplace_merge(m_order, new_begin, {}, x_of);
+
+        // The pairs (i<j) with j new, around its x
+        m_new_pairs.clear();
+        for( std::size_t j=first_new; j<n; ++j )
+           {
+            const double dx = m_reach[j] + m_max_reach + m_skin;
+            const auto lo = std::ranges::lower_bound(m_order, m_ref_pos[j].x - dx, {}, x_of);
+            for( auto it=lo; it!=m_order.end() and x_of(*it)<=m_ref_pos[j].x + dx; ++it )
+               {
+                if( *it<j and are_candidates(*it, j) ) m_new_pairs.emplace_back(*it, j);
+               }
+           }
+        std::ranges::sort(m_new_pairs);
+        const std::size_t old_pairs = m_pairs.size();
+        m_pairs.insert(m_pairs.end(), m_new_pairs.begin(), m_new_pairs.end());
+        std::ranges::inplace_merge(m_pairs, m_pairs.begin() + static_cast<std::ptrdiff_t>(old_pairs));
+        lay_out(n);
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] std::span<const std::size_t> neighbors_of(const std::size_t i) const noexcept
+       {
+        return {m_others.data() + m_first[i], m_first[i+1] - m_first[i]};
+       }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_first.empty() ? 0 : m_first.size()-1; }
+    [[nodiscard]] std::size_t pairs_count() const noexcept { return m_others.size(); }
+
+ private:
+    // Of the bodies already referenced
+    [[nodiscard]] bool moved_too_far(const std::vector<Body>& bodies) const noexcept
+       {
+        const double max_disp2 = math::square(0.5*m_skin);
+        for( std::size_t i=0; i<m_ref_pos.size(); ++i )
+           {
+            if( (bodies[i].position() - m_ref_pos[i]).norm2() > max_disp2 ) return true;
+           }
+        return false;
+       }
+
+    void take_references(const std::vector<Body>& bodies, const std::size_t first) noexcept
+       {
+        for( std::size_t i=first; i<bodies.size(); ++i )
+           {
+            m_ref_pos[i] = bodies[i].position();
+            // The sweep of the step just done must be covered too
+            m_reach[i] = bodies[i].radius() + (bodies[i].position() - bodies[i].previous_position()).norm();
+            m_max_reach = std::max(m_max_reach, m_reach[i]);
+           }
+       }
+
+    [[nodiscard]] bool are_candidates(const std::size_t i, const std::size_t j) const noexcept
+       {
+        const double dist = m_reach[i] + m_reach[j] + m_skin;
+        return (m_ref_pos[i] - m_ref_pos[j]).norm2() <= dist*dist;
+       }
+
+    // Count the pairs per body, then lay them out contiguously
+    void lay_out(const std::size_t n)
+       {
+        m_first.assign(n+1, 0);
+        for( const auto& pair : m_pairs ) ++m_first[pair.first+1];
+        std::partial_sum(m_first.begin(), m_first.end(), m_first.begin());
+        m_others.resize(m_pairs.size());
+        m_fill.assign(m_first.begin(), m_first.end()-1);
+        for( const auto& [i,j] : m_pairs ) m_others[m_fill[i]++] = j;
+       }
+};
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <random> // std::mt19937_64, std::uniform_real_distribution
+#include "Vect2D.hpp" // Vect2D
+static ut::suite<"NeighborList"> neighbors_tests = []
+{////////////////////////////////////////////////////////////////////////////
+using Body = SphericalBody<Vect2D>;
+using Pairs = std::vector<std::pair<std::size_t,std::size_t>>;
+
+auto scattered_bodies = [](std::vector<Body>& bodies, const std::size_t n, const std::uint64_t seed)
+   {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for( std::size_t i=0; i<n; ++i ) bodies.emplace_back(1.0 + 20.0*unit(rng), Vect2D{400.0*unit(rng), 400.0*unit(rng)}, Vect2D{}, bodies.size()+1);
+   };
+
+auto brute_force_pairs = [](const std::vector<Body>& bodies, const double skin)
+   {// Bodies not moved yet, so the reach is the radius
+    Pairs pairs;
+    for( std::size_t i=0; i<bodies.size(); ++i )
+        for( std::size_t j=i+1; j<bodies.size(); ++j )
+           {
+            const double dist = bodies[i].radius() + bodies[j].radius() + skin;
+            if( (bodies[i].position() - bodies[j].position()).norm2() <= dist*dist ) pairs.emplace_back(i, j);
+           }
+    return pairs;
+   };
+
+auto listed_pairs = [](const NeighborList<Vect2D>& list)
+   {
+    Pairs pairs;
+    for( std::size_t i=0; i<list.size(); ++i )
+        for( const std::size_t j : list.neighbors_of(i) ) pairs.emplace_back(i, j);
+    return pairs;
+   };
+
+ut::test("NeighborList::rebuild") = [&]
+   {
+    std::vector<Body> bodies;
+    scattered_bodies(bodies, 500, 1);
+    NeighborList<Vect2D> list(5.0);
+    list.rebuild(bodies);
+    ut::expect( list.size()==bodies.size() and list.pairs_count()>0 );
+    ut::expect( listed_pairs(list)==brute_force_pairs(bodies, 5.0) );
+    ut::expect( not list.needs_rebuild(bodies) );
+   };
+
+ut::test("NeighborList::append") = [&]
+   {
+    std::vector<Body> bodies;
+    scattered_bodies(bodies, 500, 2);
+    NeighborList<Vect2D> list(5.0);
+    list.rebuild(bodies);
+
+    ut::test("to a valid list") = [&]
+       {
+        std::size_t first_new = bodies.size();
+        scattered_bodies(bodies, 300, 3);
+        list.append(bodies, first_new);
+        first_new = bodies.size();
+        scattered_bodies(bodies, 1, 4);
+        list.append(bodies, first_new);
+        ut::expect( not list.needs_rebuild(bodies) );
+        NeighborList<Vect2D> rebuilt(5.0);
+        rebuilt.rebuild(bodies);
+        ut::expect( listed_pairs(list)==listed_pairs(rebuilt) );
+        ut::expect( listed_pairs(list)==brute_force_pairs(bodies, 5.0) );
+       };
+
+    ut::test("at the next update") = [&]
+       {
+        list.rebuild(bodies);
+        for( std::uint64_t seed=6; seed<26; ++seed ) scattered_bodies(bodies, 1, seed);
+        ut::expect( not list.update(bodies) ) << "not rebuilt";
+        ut::expect( listed_pairs(list)==brute_force_pairs(bodies, 5.0) );
+       };
+
+    ut::test("to an invalid list") = [&]
+       {
+        list.invalidate();
+        const std::size_t first_new = bodies.size();
+        scattered_bodies(bodies, 10, 5);
+        list.append(bodies, first_new);
+        ut::expect( list.needs_rebuild(bodies) );
+       };
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
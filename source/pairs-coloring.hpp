@@ -0,0 +1,119 @@
+#pragma once
+//  ---------------------------------------------
+//  Grouping of pairs in independent sets
+//  ---------------------------------------------
+#include <algorithm> // std::max
+#include <cstddef> // std::size_t
+#include <numeric> // std::partial_sum
+#include <span>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////
+// Greedy coloring of pairs (i,j) of indexes: a pair takes the color
+// following the last ones of its two indexes, so an index appears at
+// most once per color and meets its pairs color after color in their
+// original order. The pairs of a color can be processed in parallel,
+// the colors in sequence
+template<typename Pair> class PairsColoring final
+{
+ private:
+    std::vector<Pair> m_colored; // Pairs grouped by color
+    std::vector<std::size_t> m_color_first; // Where each color begins in m_colored
+    std::vector<std::size_t> m_next_color; // Of each index
+    std::vector<std::size_t> m_fill; // Insertion points while grouping
+
+ public:
+    // Pair has the members i and j, both less than n
+    void assign(const std::span<const Pair> pairs, const std::size_t n)
+       {
+        // Counting the pairs of each color
+        m_next_color.assign(n, 0);
+        m_color_first.assign(1, 0);
+        for( const Pair& pair : pairs )
+           {
+            const std::size_t color = take_color(pair);
+            if( m_color_first.size()<=color+1 ) m_color_first.resize(color+2, 0);
+            ++m_color_first[color+1];
+           }
+        std::partial_sum(m_color_first.begin(), m_color_first.end(), m_color_first.begin());
+
+        // Same coloring again, now filling the groups
+        m_colored.resize(pairs.size());
+        m_next_color.assign(n, 0);
+        m_fill.assign(m_color_first.begin(), m_color_first.end()-1);
+        for( const Pair& pair : pairs ) m_colored[m_fill[take_color(pair)]++] = pair;
+       }
+
+    [[nodiscard]] std::size_t colors_count() const noexcept { return m_color_first.size() - 1; }
+
+    [[nodiscard]] std::span<const Pair> color(const std::size_t c) const noexcept
+       {
+        return {m_colored.data() + m_color_first[c], m_color_first[c+1] - m_color_first[c]};
+       }
+
+ private:
+    [[nodiscard]] std::size_t take_color(const Pair& pair) noexcept
+       {
+        const std::size_t color = std::max(m_next_color[pair.i], m_next_color[pair.j]);
+        m_next_color[pair.i] = m_next_color[pair.j] = color + 1;
+        return color;
+       }
+};
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <random> // std::mt19937
+static ut::suite<"PairsColoring"> pairs_coloring_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+struct Pair final { std::size_t i, j, order; };
+
+ut::test("PairsColoring independent sets") = []
+   {
+    constexpr std::size_t n = 50;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::size_t> index(0, n-1);
+    std::vector<Pair> pairs;
+    while( pairs.size()<400 )
+       {
+        const std::size_t i = index(rng), j = index(rng);
+        if( i!=j ) pairs.push_back({i, j, pairs.size()});
+       }
+
+    PairsColoring<Pair> coloring;
+    coloring.assign(pairs, n);
+
+    std::size_t colored = 0;
+    bool independent = true, ordered = true;
+    std::vector<std::size_t> last_order(n, 0); // Plus one
+    for( std::size_t c=0; c<coloring.colors_count(); ++c )
+       {
+        std::vector<bool> seen(n, false);
+        for( const Pair& pair : coloring.color(c) )
+           {
+            independent = independent and not seen[pair.i] and not seen[pair.j];
+            seen[pair.i] = seen[pair.j] = true;
+            ordered = ordered and last_order[pair.i]<=pair.order and last_order[pair.j]<=pair.order;
+            last_order[pair.i] = last_order[pair.j] = pair.order + 1;
+            ++colored;
+           }
+       }
+    ut::expect( colored==pairs.size() and independent and ordered );
+   };
+
+ut::test("PairsColoring no pairs") = []
+   {
+    PairsColoring<Pair> coloring;
+    coloring.assign({}, 10);
+    ut::expect( coloring.colors_count()==0u );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,213 @@
+#pragma once
+//  ---------------------------------------------
+//  Minimal facilities for data parallelism
+//  ---------------------------------------------
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <algorithm> // std::clamp
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread> // std::jthread, std::thread::hardware_concurrency
+#include <vector>
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace par //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline std::size_t max_workers() noexcept
+{
+    const unsigned int n = std::thread::hardware_concurrency();
+    return n>0 ? n : 1;
+}
+
+//----------------------------------------------------------------------
+// How many chunks a range of n elements should be split into,
+// not worth spawning a thread for less than min_chunk elements
+[[nodiscard]] inline std::size_t chunks_count(const std::size_t n, const std::size_t min_chunk) noexcept
+{
+    return std::clamp<std::size_t>(n/(min_chunk>0 ? min_chunk : 1), 1, max_workers());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Threads kept waiting for work, so that the frequent parallel loops
+// don't pay the creation of threads at each call. Runs a job at a time:
+// the job is split in chunks taken one by one by the workers and by
+// the calling thread itself
+class Pool final
+{
+    struct Job final
+       {
+        void (*run)(void*, std::size_t) noexcept; // Calls fn with a chunk index
+        void* fn;
+        std::size_t chunks;
+        std::atomic<std::size_t> next{0}; // First chunk not yet taken
+
+        void work() noexcept
+           {
+            for( std::size_t c=next++; c<chunks; c=next++ ) run(fn, c);
+           }
+       };
+
+ private:
+    std::mutex m_busy; // Held while running a job
+    std::mutex m_mutex; // Guards the members below
+    std::condition_variable m_wake, m_idle;
+    Job* m_job = nullptr; // The running one
+    std::uint64_t m_generation = 0; // Of the jobs, so a worker takes each once
+    std::size_t m_working = 0; // Workers inside a job
+    bool m_stop = false;
+    std::vector<std::jthread> m_threads; // Declared last, joined first
+
+ public:
+    explicit Pool(const std::size_t workers)
+       {
+        m_threads.reserve(workers);
+        for( std::size_t t=0; t<workers; ++t ) m_threads.emplace_back([this]() noexcept { serve(); });
+       }
+
+    ~Pool()
+       {
+           {
+            const std::lock_guard lock(m_mutex);
+            m_stop = true;
+           }
+        m_wake.notify_all();
+       }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    // Shared by the whole program, created at first use
+    [[nodiscard]] static Pool& instance()
+       {
+        static Pool pool(max_workers()-1);
+        return pool;
+       }
+
+    //-----------------------------------------------------------------------
+    // Calls run_chunk(c) for each c in [0,chunks) and returns when all done,
+    // or returns false at once if the pool is already running a job
+    template<typename F> [[nodiscard]] bool try_run(const std::size_t chunks, F& run_chunk)
+       {
+        const std::unique_lock busy(m_busy, std::try_to_lock);
+        if( not busy.owns_lock() or m_threads.empty() ) return false;
+
+        Job job{ [](void* const fn, const std::size_t c) noexcept { (*static_cast<F*>(fn))(c); }, &run_chunk, chunks };
+           {
+            const std::lock_guard lock(m_mutex);
+            m_job = &job;
+            ++m_generation;
+           }
+        m_wake.notify_all();
+        job.work();
+
+        // All chunks taken, waiting the workers still on them
+        std::unique_lock lock(m_mutex);
+        m_job = nullptr;
+        m_idle.wait(lock, [this]() noexcept { return m_working==0; });
+        return true;
+       }
+
+ private:
+    void serve() noexcept
+       {
+        std::uint64_t served = 0; // Last job generation
+        std::unique_lock lock(m_mutex);
+        while( true )
+           {
+            m_wake.wait(lock, [&]() noexcept { return m_stop or (m_job and m_generation!=served); });
+            if( m_stop ) return;
+            served = m_generation;
+            Job& job = *m_job;
+            ++m_working;
+            lock.unlock();
+            job.work();
+            lock.lock();
+            if( --m_working==0 ) m_idle.notify_all();
+           }
+       }
+};
+
+
+//----------------------------------------------------------------------
+// Calls fn(chunk_index, begin, end) for each of the k contiguous chunks
+// of [0,n) using the Pool, the calling thread included; returns when all
+// done. When the pool is busy (concurrent or nested calls) the chunks
+// get dedicated threads instead
+template<typename F> void for_chunks(const std::size_t n, const std::size_t k, F&& fn)
+{
+    auto chunk_begin = [n,k](const std::size_t c) noexcept { return (n*c)/k; };
+    if( k<=1 )
+       {
+        fn(std::size_t{0}, std::size_t{0}, n);
+        return;
+       }
+    auto run_chunk = [&fn, &chunk_begin](const std::size_t c) noexcept { fn(c, chunk_begin(c), chunk_begin(c+1)); };
+    if( Pool::instance().try_run(k, run_chunk) ) return;
+
+    std::vector<std::jthread> workers;
+    workers.reserve(k-1);
+    for( std::size_t c=1; c<k; ++c )
+       {
+        workers.emplace_back([&run_chunk, c]() noexcept { run_chunk(c); });
+       }
+    run_chunk(0);
+    // The jthreads join on destruction
+}
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+static ut::suite<"par"> par_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("par::Pool") = []
+   {
+    par::Pool pool(3);
+    std::vector<std::atomic<int>> runs(10);
+    bool all_run = true;
+    for( int job=0; job<1000; ++job )
+       {
+        auto run_chunk = [&runs](const std::size_t c) noexcept { ++runs[c]; };
+        all_run = pool.try_run(runs.size(), run_chunk) and all_run;
+       }
+    bool once_per_job = true;
+    for( const auto& r : runs ) once_per_job = once_per_job and r==1000;
+    ut::expect( all_run and once_per_job );
+
+    std::atomic<bool> nested_run = false;
+    auto outer = [&](const std::size_t) noexcept
+       {
+        auto inner = [](const std::size_t) noexcept {};
+        if( pool.try_run(2, inner) ) nested_run = true;
+       };
+    ut::expect( pool.try_run(4, outer) and not nested_run ); // Busy
+   };
+
+ut::test("par::for_chunks") = []
+   {
+    std::vector<int> visits(1000, 0);
+    std::vector<std::atomic<int>> chunks(7);
+    par::for_chunks(visits.size(), chunks.size(), [&](const std::size_t c, const std::size_t b, const std::size_t e)
+       {
+        ++chunks[c];
+        for( std::size_t i=b; i<e; ++i ) ++visits[i];
+       });
+    bool once = true;
+    for( const int n : visits ) once = once and n==1;
+    for( const auto& n : chunks ) once = once and n==1;
+    ut::expect( once );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
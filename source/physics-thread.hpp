@@ -0,0 +1,209 @@
+#pragma once
+//  ---------------------------------------------
+//  Evolution of a N-body model on a dedicated thread
+//  ---------------------------------------------
+#include <algorithm> // std::min, std::max, std::clamp
+#include <chrono> // std::chrono::*
+#include <cstdint> // std::uint8_t, std::uint64_t
+#include <stop_token> // std::stop_token
+#include <thread> // std::jthread, std::this_thread::sleep_for
+#include <utility> // std::move
+#include <vector>
+
+#include "universe.hpp" // Universe
+#include "scenarios.hpp" // scenarios::plummer_sphere, scenarios::rotating_disk
+#include "spsc-queue.hpp" // SpscQueue
+#include "triple-buffer.hpp" // TripleBuffer
+
+
+////////////////////////////////////////////////////////////////////////
+// What the user interface needs of the universe state
+struct Snapshot final
+{
+    using clock = std::chrono::steady_clock;
+
+    double time = 0.0; // [time] Of the universe
+    double dt = 0.0; // [time] Of the steps
+    double E = 0.0; // Total energy
+    Universe::Vect Cm; // Center of mass
+    std::vector<Universe::Body> bodies;
+    clock::time_point published; // When taken
+    double leftover = 0.0; // [time] Not yet simulated when taken
+    double k_time = 0.0; // Requested simulated time per wall clock second
+    double time_warp = 0.0; // Actual simulated time per wall clock second
+
+    // Fraction of the next step that should be shown at a given moment,
+    // to interpolate between previous and current positions
+    [[nodiscard]] float interpolation_at(const clock::time_point now) const noexcept
+       {
+        if( dt<=0.0 ) return 1.0f;
+        const double sim_ahead = leftover + k_time * std::chrono::duration<double>(now - published).count();
+        return static_cast<float>(std::clamp(sim_ahead/dt, 0.0, 1.0));
+       }
+};
+
+
+////////////////////////////////////////////////////////////////////////
+// Requests from the user interface, applied between two steps
+struct Command final
+{
+    enum class Kind : std::uint8_t
+       {
+        add_body,
+        set_time_warp,
+        add_plummer, // A Plummer sphere centered in pos
+        add_disk // A central mass with a rotating disk around
+       };
+
+    Kind kind = Kind::add_body;
+    double mass = 0.0; // Total, for the clusters
+    Universe::Vect pos, spd;
+    double k_time = 0.0; // Of set_time_warp
+    std::size_t count = 0; // Bodies of the clusters
+    double size = 0.0; // [<space>] Plummer radius or disk radius
+};
+
+
+////////////////////////////////////////////////////////////////////////
+// Owns the universe and evolves it with a fixed time step, the simulated
+// time following the wall clock by a factor: the steps due are done in
+// a burst, with a limit on the wall time they can take (if the physics
+// can't keep up, the simulation just slows down instead of taking bigger
+// steps). The other threads see just the published snapshots and
+// interact through commands, so the rendering and the physics don't
+// slow each other
+class PhysicsThread final
+{
+    using clock = std::chrono::steady_clock;
+    static constexpr auto burst_budget = std::chrono::milliseconds(16);
+    static constexpr auto max_sleep = std::chrono::milliseconds(5); // To stay responsive to commands
+
+ private:
+    Universe m_universe;
+    double m_dt; // [time] Fixed step
+    double m_k_time; // Simulated time per wall clock second
+    double m_time_warp = 0.0; // Measured
+    TripleBuffer<Snapshot> m_snapshots;
+    SpscQueue<Command> m_commands{1024};
+    std::vector<Universe::NewBody> m_new_bodies; // Added all together
+    std::uint64_t m_clusters_count = 0; // To vary the clusters
+    std::jthread m_thread; // Declared last, so it stops before the rest is destroyed
+
+ public:
+    //                                            Time step          Simulated time per second
+    explicit PhysicsThread(Universe universe, const double dt, const double k_time =1.0)
+      : m_universe(std::move(universe))
+      , m_dt(dt)
+      , m_k_time(k_time)
+       {
+        take_snapshot(0.0);
+        m_thread = std::jthread([this](const std::stop_token stop){ loop(stop); });
+       }
+
+    // From the user interface thread (the only one allowed to post).
+    // Never waits: returns false and drops the command if the queue is full
+    [[nodiscard]] bool post(const Command& cmd) noexcept { return m_commands.try_push(cmd); }
+
+    // The last published state, stable until the next call
+    [[nodiscard]] const Snapshot& latest() noexcept
+       {
+        m_snapshots.update();
+        return m_snapshots.front();
+       }
+
+ private:
+    void loop(const std::stop_token stop)
+       {
+        double leftover = 0.0; // [time] To be simulated
+        auto before = clock::now();
+        auto warp_start = before; // Of the time warp measure
+        double warp_sim_start = m_universe.time();
+        while( not stop.stop_requested() )
+           {
+            bool changed = apply_commands();
+
+            const auto now = clock::now();
+            leftover += m_k_time * std::chrono::duration<double>(now - before).count();
+            before = now;
+            while( leftover>=m_dt )
+               {
+                m_universe.evolve_verlet(m_dt);
+                m_universe.handle_collisions();
+                m_universe.handle_escapers();
+                leftover -= m_dt;
+                changed = true;
+                if( clock::now()-now > burst_budget )
+                   {// Can't keep up, drop the backlog
+                    leftover = std::min(leftover, m_dt);
+                    break;
+                   }
+               }
+
+            if( now-warp_start >= std::chrono::milliseconds(500) )
+               {
+                m_time_warp = (m_universe.time() - warp_sim_start) / std::chrono::duration<double>(now - warp_start).count();
+                warp_start = now;
+                warp_sim_start = m_universe.time();
+               }
+
+            if( changed )
+               {
+                take_snapshot(leftover);
+               }
+            else
+               {// Waiting the next step
+                const auto until_next = std::chrono::duration<double>(m_k_time>0.0 ? (m_dt-leftover)/m_k_time : 1.0);
+                std::this_thread::sleep_for( std::min(std::chrono::duration_cast<clock::duration>(until_next), clock::duration(max_sleep)) );
+               }
+           }
+       }
+
+    [[nodiscard]] bool apply_commands()
+       {
+        static constexpr double disk_mass_fraction = 0.1; // The rest is the central mass
+        bool any = false;
+        Command cmd;
+        m_new_bodies.clear();
+        auto add_new = [this](const std::vector<Universe::NewBody>& bodies){ m_new_bodies.insert(m_new_bodies.end(), bodies.begin(), bodies.end()); };
+        while( m_commands.try_pop(cmd) )
+           {
+            switch( cmd.kind )
+               {
+                case Command::Kind::add_body:
+                    m_new_bodies.push_back({cmd.mass, cmd.pos, cmd.spd});
+                    break;
+
+                case Command::Kind::set_time_warp:
+                    m_k_time = std::max(cmd.k_time, 0.0);
+                    break;
+
+                case Command::Kind::add_plummer:
+                    add_new( scenarios::plummer_sphere(cmd.count, cmd.mass, cmd.size, cmd.pos, cmd.spd, m_universe.G, ++m_clusters_count) );
+                    break;
+
+                case Command::Kind::add_disk:
+                    add_new( scenarios::rotating_disk(cmd.count, (1.0-disk_mass_fraction)*cmd.mass, disk_mass_fraction*cmd.mass,
+                                                      cmd.size/10.0, cmd.size, cmd.pos, cmd.spd, m_universe.G, ++m_clusters_count) );
+                    break;
+               }
+            any = true;
+           }
+        if( not m_new_bodies.empty() ) m_universe.add_bodies(m_new_bodies);
+        return any;
+       }
+
+    void take_snapshot(const double leftover)
+       {
+        Snapshot& snap = m_snapshots.back();
+        snap.time = m_universe.time();
+        snap.dt = m_dt;
+        snap.E = m_universe.total_energy();
+        snap.Cm = m_universe.center_of_mass();
+        snap.bodies.assign(m_universe.bodies().begin(), m_universe.bodies().end());
+        snap.published = clock::now();
+        snap.leftover = leftover;
+        snap.k_time = m_k_time;
+        snap.time_warp = m_time_warp;
+        m_snapshots.publish();
+       }
+};
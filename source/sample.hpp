@@ -0,0 +1,80 @@
+#pragma once
+//  ---------------------------------------------
+//  A sample of the evolution of a N-body model
+//  and the interface of its consumers
+//  ---------------------------------------------
+#include <cstdint> // std::uint8_t
+#include <vector>
+#include <utility> // std::move
+
+#include "universe.hpp" // Universe
+
+
+////////////////////////////////////////////////////////////////////////
+struct Sample final
+{
+    // What a sample can contain
+    static constexpr std::uint8_t has_bodies = 1u << 0;
+    static constexpr std::uint8_t has_energies = 1u << 1;
+    static constexpr std::uint8_t has_cm = 1u << 2;
+    static constexpr std::uint8_t has_all = has_bodies | has_energies | has_cm;
+
+    double time = 0.0;
+    std::vector<Universe::Body> bodies; // Bodies status
+    Universe::Vect Cm; // Center of mass
+    double Ek = 0.0, // Kinetic energy
+           Eu = 0.0; // Potential energy
+    std::uint8_t content = has_all; // Which of the above are valid
+
+    [[nodiscard]] bool has(const std::uint8_t what) const noexcept { return (content & what)==what; }
+};
+
+
+////////////////////////////////////////////////////////////////////////
+// Where the samples are pushed while simulating: the pushed sample is
+// reused by the caller, so must be copied if needed after push returns
+class SampleSink
+{
+ public:
+    virtual ~SampleSink() = default;
+    virtual void push(const Sample&) = 0;
+    virtual void finish() {} // No more samples
+};
+
+
+////////////////////////////////////////////////////////////////////////
+template<typename F> class CallbackSink final : public SampleSink
+{
+ private:
+    F m_fn;
+
+ public:
+    explicit CallbackSink(F fn) noexcept
+      : m_fn(std::move(fn))
+       {}
+
+    void push(const Sample& s) override { m_fn(s); }
+};
+
+
+////////////////////////////////////////////////////////////////////////
+// Forwards the samples to several sinks
+class MultiSink final : public SampleSink
+{
+ private:
+    std::vector<SampleSink*> m_sinks;
+
+ public:
+    void add(SampleSink& sink) { m_sinks.push_back(&sink); }
+    [[nodiscard]] bool empty() const noexcept { return m_sinks.empty(); }
+
+    void push(const Sample& s) override
+       {
+        for( SampleSink* sink : m_sinks ) sink->push(s);
+       }
+
+    void finish() override
+       {
+        for( SampleSink* sink : m_sinks ) sink->finish();
+       }
+};
@@ -0,0 +1,72 @@
+#pragma once
+//  ---------------------------------------------
+//  When to record the data of a simulation
+//  ---------------------------------------------
+#include <cmath> // std::floor, std::abs
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint8_t
+
+#include "sample.hpp" // Sample
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace sampling //::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// The periodicity of a kind of data
+class Cadence final
+{
+ private:
+    std::size_t m_steps = 0; // Every n steps (0:not used)
+    double m_interval = 0.0; // Every simulated time interval (0:not used)
+
+    constexpr Cadence(const std::size_t steps, const double interval) noexcept
+      : m_steps(steps)
+      , m_interval(interval)
+       {}
+
+ public:
+    [[nodiscard]] static constexpr Cadence every_step() noexcept { return {1, 0.0}; }
+    [[nodiscard]] static constexpr Cadence every_steps(const std::size_t n) noexcept { return {n, 0.0}; }
+    [[nodiscard]] static constexpr Cadence every_time(const double interval) noexcept { return {0, interval}; }
+    [[nodiscard]] static constexpr Cadence never() noexcept { return {0, 0.0}; }
+
+    //                                   Steps done        Time before and after the step
+    [[nodiscard]] bool is_due(const std::size_t step, const double t_prev, const double t) const noexcept
+       {
+        if( m_steps>0 ) return step % m_steps == 0;
+        if( m_interval>0.0 ) return std::floor(t/m_interval) > std::floor(t_prev/m_interval);
+        return false;
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+struct Policy final
+{
+    Cadence bodies = Cadence::every_step(); // Status of each body
+    Cadence energies = Cadence::every_step();
+    Cadence cm = Cadence::every_step(); // Center of mass
+    bool on_merger = false; // Record everything when bodies merge
+    double energy_jump = 0.0; // Record everything when the total energy changes more than this fraction (0:off)
+
+    //-----------------------------------------------------------------------
+    // What is to be recorded after a step
+    [[nodiscard]] std::uint8_t due_content(const std::size_t step, const double t_prev, const double t, const bool merged) const noexcept
+       {
+        if( merged and on_merger ) return Sample::has_all;
+        std::uint8_t content = 0;
+        if( bodies.is_due(step, t_prev, t) ) content |= Sample::has_bodies;
+        if( energies.is_due(step, t_prev, t) ) content |= Sample::has_energies;
+        if( cm.is_due(step, t_prev, t) ) content |= Sample::has_cm;
+        return content;
+       }
+
+    [[nodiscard]] bool is_energy_jump(const double E_ref, const double E) const noexcept
+       {
+        return energy_jump>0.0 and std::abs(E - E_ref) > energy_jump * std::abs(E_ref);
+       }
+};
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
@@ -0,0 +1,173 @@
+#pragma once
+//  ---------------------------------------------
+//  Some initial conditions of a N-body model
+//  ---------------------------------------------
+#include <cmath> // std::sqrt, std::cos, std::sin, std::pow
+#include <cstdint> // std::uint64_t
+#include <numbers> // std::numbers::pi
+#include <random> // std::mt19937_64, std::uniform_real_distribution
+#include <vector>
+
+#include "universe.hpp" // Universe
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace scenarios //:::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline Universe small_around_big()
+{
+    Universe universe(1.0); // Our universe: 6.67408E-11 m³/kg s²
+    // Adding bodies (mass, initial position and speed)
+    universe.add_body(5000, {400,400}, {0,0})
+            .add_body(200, {200,400}, {0,4})
+            .add_body(300, {700,400}, {0,-2})
+            .add_body(200, {400,500}, {10,0})
+            .add_body(500, {400,300}, {-5,0});
+    return universe;
+}
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline Universe coll_test()
+{
+    Universe universe(0.0);
+    universe.add_body(40000, {300,400}, {2,1})
+            .add_body(20000, {500,396}, {-2,1});
+    return universe;
+}
+
+//----------------------------------------------------------------------
+// N bodies uniformly scattered in a disk, with small random speeds
+[[nodiscard]] inline Universe uniform_disk(const std::size_t N, const std::uint64_t seed =1)
+{
+    Universe universe(1.0);
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double R = 40.0 * std::sqrt(static_cast<double>(N)); // Constant density
+    std::vector<Universe::NewBody> bodies(N);
+    for( Universe::NewBody& body : bodies )
+       {
+        const double r = R * std::sqrt(unit(rng));
+        const double a = 2.0 * std::numbers::pi * unit(rng);
+        body = { 1.0 + 9.0 * unit(rng), {r*std::cos(a), r*std::sin(a)}, {unit(rng)-0.5, unit(rng)-0.5} };
+       }
+    universe.add_bodies(bodies);
+    return universe;
+}
+
+
+// Clusters to be added to a universe, with a given center and velocity
+
+//----------------------------------------------------------------------
+// A Plummer sphere projected on the plane: N equal masses with density
+// ∝ (1 + r²/a²)^-5/2, speeds sampled from its distribution function
+// (Aarseth, Hénon, Wielen 1974). The projection isn't in equilibrium in
+// the plane, so the speeds are then scaled to the virial equilibrium of
+// the actual positions (2Ek = -Eu), paying the O(N²) potential energy
+[[nodiscard]] inline std::vector<Universe::NewBody> plummer_sphere(const std::size_t N, const double total_mass, const double a,
+                                                                   const Universe::Vect& center, const Universe::Vect& velocity,
+                                                                   const double G, const std::uint64_t seed =1)
+{
+    const double max_radius = 10.0 * a; // Like Aarseth, Hénon, Wielen
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    // A random direction in space, seen from above
+    auto projected_direction = [&rng, &unit]() -> Universe::Vect
+       {
+        const double cos_theta = 2.0 * unit(rng) - 1.0;
+        const double phi = 2.0 * std::numbers::pi * unit(rng);
+        const double sin_theta = std::sqrt(1.0 - cos_theta*cos_theta);
+        return { sin_theta * std::cos(phi), sin_theta * std::sin(phi) };
+       };
+
+    std::vector<Universe::NewBody> bodies(N);
+    for( Universe::NewBody& body : bodies )
+       {
+        double r = 0.0;
+        do{ r = a / std::sqrt(std::pow(unit(rng), -2.0/3.0) - 1.0); } while( r>max_radius ); // Cutting off the far tail
+        // Speed as fraction q of the escape speed, by rejection of g(q) = q²(1-q²)^7/2
+        double q = 0.0;
+        do{ q = unit(rng); } while( 0.1*unit(rng) > q*q*std::pow(1.0 - q*q, 3.5) );
+        const double v_esc = std::sqrt(2.0 * G * total_mass / std::sqrt(r*r + a*a));
+        body = { total_mass / static_cast<double>(N),
+                 center + r * projected_direction(),
+                 q * v_esc * projected_direction() };
+       }
+
+    // Virial scaling of the speeds, relative to the bulk motion
+    double Ek = 0.0, Eu = 0.0;
+    for( std::size_t i=0; i<N; ++i )
+       {
+        Ek += 0.5 * bodies[i].mass * bodies[i].spd.norm2();
+        for( std::size_t j=i+1; j<N; ++j )
+           {
+            const double r = (bodies[i].pos - bodies[j].pos).norm();
+            if( r>0.0 ) Eu -= G * bodies[i].mass * bodies[j].mass / r;
+           }
+       }
+    const double k = Ek>0.0 ? std::sqrt(-Eu / (2.0*Ek)) : 1.0;
+    for( Universe::NewBody& body : bodies ) body.spd = velocity + k * body.spd;
+    return bodies;
+}
+
+//----------------------------------------------------------------------
+// A central mass with a disk of N light bodies in circular orbits
+[[nodiscard]] inline std::vector<Universe::NewBody> rotating_disk(const std::size_t N, const double central_mass, const double disk_mass,
+                                                                  const double r_min, const double r_max,
+                                                                  const Universe::Vect& center, const Universe::Vect& velocity,
+                                                                  const double G, const std::uint64_t seed =1)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<Universe::NewBody> bodies;
+    bodies.reserve(N+1);
+    bodies.push_back({central_mass, center, velocity});
+    for( std::size_t i=0; i<N; ++i )
+       {
+        const double r = std::sqrt(r_min*r_min + unit(rng)*(r_max*r_max - r_min*r_min)); // Uniform surface density
+        const double a = 2.0 * std::numbers::pi * unit(rng);
+        const Universe::Vect dir{ std::cos(a), std::sin(a) };
+        // Attracted by the central mass and the inner part of the disk
+        const double inner_mass = disk_mass * (r*r - r_min*r_min) / (r_max*r_max - r_min*r_min);
+        const double v = std::sqrt(G * (central_mass + inner_mass) / r);
+        bodies.push_back({ disk_mass / static_cast<double>(N),
+                           center + r * dir,
+                           velocity + v * Universe::Vect{-dir.y, dir.x} });
+       }
+    return bodies;
+}
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+static ut::suite<"scenarios"> scenarios_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("scenarios::plummer_sphere") = []
+   {
+    const Universe::Vect center{500.0,-200.0};
+    const auto bodies = scenarios::plummer_sphere(5000, 5000.0, 50.0, center, {}, 1.0, 7);
+    ut::expect( bodies.size()==5000u );
+    bool bounded = true;
+    for( const auto& body : bodies ) bounded = bounded and (body.pos - center).norm()<=500.0;
+    ut::expect( bounded ) << "far tail cut at 10 radii";
+
+    double Ek = 0.0, Eu = 0.0;
+    for( std::size_t i=0; i<bodies.size(); ++i )
+       {
+        Ek += 0.5 * bodies[i].mass * bodies[i].spd.norm2();
+        for( std::size_t j=i+1; j<bodies.size(); ++j ) Eu -= bodies[i].mass * bodies[j].mass / (bodies[i].pos - bodies[j].pos).norm();
+       }
+    ut::expect( std::abs(2.0*Ek + Eu) < 1e-9 * std::abs(Eu) ) << "virial equilibrium";
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
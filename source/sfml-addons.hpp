@@ -78,6 +78,11 @@ class View
     sf::View i_view;
     Pan i_pan;
     Zoom i_zoom;
+    sf::VertexArray i_grid{sf::Lines};
+    sf::FloatRect i_grid_rect; // Of the current grid vertices
+    float i_grid_dx = 0.0f;
+    float i_grid_dy = 0.0f;
+    sf::Color i_grid_color;
 
  public:
     explicit View(sf::RenderWindow& w) noexcept
@@ -94,6 +99,13 @@ class View
         return sf::FloatRect(c.x-siz.x/2.0f, c.y-siz.y/2.0f, siz.x, siz.y);
        }
 
+    // Size of a screen pixel in view coordinates
+    [[nodiscard]] float pixel_size() const noexcept
+       {
+        const unsigned int w_pix = i_window.getSize().x;
+        return w_pix>0 ? i_view.getSize().x/static_cast<float>(w_pix) : 1.0f;
+       }
+
     void resize(const unsigned int x_pix, const unsigned int y_pix) noexcept
        {
         i_view.setSize(i_zoom.width_of(x_pix), i_zoom.height_of(y_pix));
@@ -107,42 +119,70 @@ class View
 
     void zoom(const sf::Vector2i& mouse_pix, const bool out) noexcept { i_zoom(i_window,i_view,mouse_pix,out); }
 
-    void draw_grid(const float dx, const float dy, sf::Color color) noexcept
+    // Lines every dx,dy scaled by powers of ten to keep them some pixels
+    // apart, the major ones (every ten) more visible; the vertices are
+    // regenerated just when the view changes
+    void draw_grid(const float dx, const float dy, const sf::Color color)
        {
         const sf::FloatRect r = rect();
+        if( not (r==i_grid_rect) or dx!=i_grid_dx or dy!=i_grid_dy or not (color==i_grid_color) )
+           {
+            i_grid_rect = r;
+            i_grid_dx = dx;
+            i_grid_dy = dy;
+            i_grid_color = color;
+            build_grid();
+           }
+        i_window.draw(i_grid);
+       }
+
+ private:
+    void build_grid()
+       {
+        const sf::FloatRect& r = i_grid_rect;
         const float r_right = r.left + r.width;
         const float r_bottom = r.top + r.height;
-
-        sf::Vertex vertices[2];
-        vertices[0].color = color;
-        vertices[1].color = color;
+        const sf::Color minor_color{i_grid_color.r, i_grid_color.g, i_grid_color.b, static_cast<sf::Uint8>(i_grid_color.a/3)};
+        const float px = pixel_size();
+        i_grid.clear();
 
         // Vertical lines
-        if( dx>0.0f )
+        if( i_grid_dx>0.0f )
            {
-            float x = dx * std::ceil(r.left/dx);
-            while( x < r_right )
+            const float step = adapted_step(i_grid_dx, px);
+            for( auto i=static_cast<long long>(std::ceil(r.left/step)); static_cast<float>(i)*step<r_right; ++i )
                {
-                vertices[0].position = {x,r.top};
-                vertices[1].position = {x,r_bottom};
-                i_window.draw(vertices, 2, sf::Lines);
-                x += dx;
+                const float x = static_cast<float>(i) * step;
+                const sf::Color& col = i%10==0 ? i_grid_color : minor_color;
+                i_grid.append( sf::Vertex({x,r.top}, col) );
+                i_grid.append( sf::Vertex({x,r_bottom}, col) );
                }
            }
 
         // Horizontal lines
-        if( dy>0.0f )
+        if( i_grid_dy>0.0f )
            {
-            float y = dy * std::ceil(r.top/dy);
-            while( y < r_bottom )
+            const float step = adapted_step(i_grid_dy, px);
+            for( auto i=static_cast<long long>(std::ceil(r.top/step)); static_cast<float>(i)*step<r_bottom; ++i )
                {
-                vertices[0].position = {r.left,y};
-                vertices[1].position = {r_right,y};
-                i_window.draw(vertices, 2, sf::Lines);
-                y += dy;
+                const float y = static_cast<float>(i) * step;
+                const sf::Color& col = i%10==0 ? i_grid_color : minor_color;
+                i_grid.append( sf::Vertex({r.left,y}, col) );
+                i_grid.append( sf::Vertex({r_right,y}, col) );
                }
            }
        }
+
+    // Minor lines spacing: d/10 scaled by a power of ten to stay 8÷80 pixels apart
+    [[nodiscard]] static float adapted_step(const float d, const float pixel_size) noexcept
+       {
+        constexpr float min_pix = 8.0f;
+        float step = d / 10.0f;
+        if( not (pixel_size>0.0f) ) return step;
+        while( step/pixel_size < min_pix ) step *= 10.0f;
+        while( step/pixel_size >= 10.0f*min_pix ) step /= 10.0f;
+        return step;
+       }
 };
 
 
@@ -2,91 +2,201 @@
 //  ---------------------------------------------
 //  Gather data of an evolution of a N-body model
 //  ---------------------------------------------
-#include <fstream>
+#include <cassert>
+#include <cmath> // std::isnan
+#include <cstdint> // std::uint64_t
+#include <cstring> // std::memcpy
+#include <limits> // std::numeric_limits
+#include <stdexcept> // std::runtime_error
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "universe.hpp" // Universe
+#include "sample.hpp" // Sample, SampleSink
+#include "csv-export.hpp" // csv::*
+#include "merger-log.hpp" // mergers::Log
+#include "checkpoint.hpp" // CheckpointWriter
+#include "sampling.hpp" // sampling::Policy
+#include "diagnostics.hpp" // Diagnostics
 
 
 ////////////////////////////////////////////////////////////////////////
-class SimulationData final
+// Keeps in memory just the last samples
+class SimulationData final : public SampleSink
 {
-    struct Sample final
-       {
-        double time;
-        std::vector<Universe::Body> bodies; // Bodies status
-        Universe::Vect Cm; // Center of mass
-        double Ek, // Kinetic energy
-               Eu; // Potential energy
-       };
-
  private:
-    std::vector<Sample> m_samples;
+    std::vector<Sample> m_samples; // Ring buffer
+    std::size_t m_max_samples;
+    std::size_t m_first = 0; // Oldest sample
+    std::size_t m_count = 0;
 
  public:
-    [[nodiscard]] const std::vector<Sample>& samples() const noexcept { return m_samples; }
+    explicit SimulationData(const std::size_t max_samples =1000) noexcept
+      : m_max_samples(max_samples>0 ? max_samples : 1)
+       {}
 
-    void init(const std::size_t N) noexcept
+    [[nodiscard]] std::size_t size() const noexcept { return m_count; }
+    [[nodiscard]] bool empty() const noexcept { return m_count==0; }
+    [[nodiscard]] std::size_t max_size() const noexcept { return m_max_samples; }
+
+    // Chronological access, 0 being the oldest
+    [[nodiscard]] const Sample& sample(const std::size_t i) const noexcept
        {
-        m_samples.clear();
-        m_samples.reserve(N);
+        assert(i<m_count);
+        return m_samples[(m_first + i) % m_max_samples];
        }
+    [[nodiscard]] const Sample& last() const noexcept { return sample(m_count-1); }
 
-    void collect(const double t,
-                 const std::vector<Universe::Body>& bd,
-                 const Universe::Vect& cm,
-                 const double ek,
-                 const double eu)
+    void clear() noexcept
        {
-        m_samples.emplace_back( {t,bd,cm,ek,eu} );
+        m_first = m_count = 0;
        }
 
-    void save_to_file(std::string fpath) const
+    void push(const Sample& s) override
        {
-        std::ofstream f (fpath, std::ios::out);
-        if(!f.is_open()) throw std::runtime_error("Unable to open file " + fpath);
-        //f << "time,total-energy\n";
-        //for(const Sample& s : m_samples)
-        //    f << s.time << ',' << (s.Ek+s.Eu) << '\n';
-        f << "time,bodies-xyz-pos\n";
-        for(const Sample& s : m_samples)
+        if( m_count<m_max_samples )
            {
-            f << s.time;
-            for(const auto& body : s.bodies)
-                f << ',' << body.position();
-            f << '\n';
+            if( m_samples.size()<=m_count ) m_samples.push_back(s);
+            else m_samples[m_count] = s; // Reusing storage
+            ++m_count;
+           }
+        else
+           {// Overwrite the oldest
+            m_samples[m_first] = s;
+            m_first = (m_first + 1) % m_max_samples;
            }
        }
+
+    void save_to_file(const std::string& fpath, const csv::Columns columns ={csv::Column::positions}) const
+       {
+        csv::save(*this, fpath, columns);
+       }
 };
 
 
+////////////////////////////////////////////////////////////////////////
+// Writes the samples to a text file as they come, in the same format
+// of SimulationData::save_to_file()
+using TextFileSink = csv::FileSink;
+
+
 ////////////////////////////////////////////////////////////////////////
 class Simulation final
 {
  private:
-    SimulationData m_data;
+    SimulationData m_data; // The last samples
+    Sample m_sample; // Reused at each step
+    sampling::Policy m_sampling;
+    mergers::Log* m_mergers_log = nullptr;
+    Diagnostics* m_diagnostics = nullptr;
+    CheckpointWriter* m_checkpoint = nullptr;
+    std::size_t m_checkpoint_steps = 0; // Steps between checkpoints
+    std::size_t m_steps = 0; // Steps done
+    double m_E_ref = std::numeric_limits<double>::quiet_NaN(); // Total energy last recorded (NaN:none yet)
 
  public:
+    explicit Simulation(const std::size_t kept_samples =1000) noexcept
+      : m_data(kept_samples)
+       {}
+
     [[nodiscard]] const SimulationData& data() const noexcept { return m_data; }
 
+    void log_mergers_to(mergers::Log& log) noexcept { m_mergers_log = &log; }
+
+    void monitor_with(Diagnostics& diagnostics) noexcept { m_diagnostics = &diagnostics; }
+
+    void set_sampling(const sampling::Policy& policy) noexcept { m_sampling = policy; }
+
+    // No checkpoints if steps is zero
+    void checkpoint_every(const std::size_t steps, CheckpointWriter& writer) noexcept
+       {
+        m_checkpoint = steps>0 ? &writer : nullptr;
+        m_checkpoint_steps = steps;
+       }
+
+    // The steps done and the energy reference go in the checkpoints as
+    // user state, so a restarted run keeps the cadences of the original
+    [[nodiscard]] std::string run_state() const
+       {
+        std::string state(run_state_size, '\0');
+        const auto steps = static_cast<std::uint64_t>(m_steps);
+        std::memcpy(state.data(), &steps, sizeof(steps));
+        std::memcpy(state.data()+sizeof(steps), &m_E_ref, sizeof(m_E_ref));
+        return state;
+       }
+
+    void restore_run_state(const std::string_view state)
+       {
+        if( state.size()!=run_state_size ) throw std::runtime_error("Invalid simulation run state");
+        std::uint64_t steps;
+        std::memcpy(&steps, state.data(), sizeof(steps));
+        std::memcpy(&m_E_ref, state.data()+sizeof(steps), sizeof(m_E_ref));
+        m_steps = static_cast<std::size_t>(steps);
+       }
+
     //                                 Total time    Time increment
     void execute(Universe& universe, const double T, const double dt)
        {
-        m_data.init( static_cast<std::size_t>(std::ceil(T/dt)) );
+        m_data.clear();
+        execute(universe, T, dt, m_data);
+       }
 
+    // Samples are streamed to sink, memory use doesn't depend on T
+    void execute(Universe& universe, const double T, const double dt, SampleSink& sink)
+       {
+        const bool track_energy = m_sampling.energy_jump>0.0;
+        if( track_energy and std::isnan(m_E_ref) ) m_E_ref = universe.total_energy();
         double t = 0.0;
         do {
-            universe.evolve(dt);
+            const double t_prev = universe.time();
+            universe.evolve_verlet(dt);
+            universe.handle_collisions();
+            universe.handle_escapers();
+            if( m_mergers_log ) m_mergers_log->push(universe.mergers());
+            ++m_steps;
+            if( m_diagnostics ) m_diagnostics->observe(universe, m_steps, t_prev);
+
+            // Just what's needed is computed
+            std::uint8_t content = m_sampling.due_content(m_steps, t_prev, universe.time(), not universe.mergers().empty());
+            if( track_energy and not (content & Sample::has_energies) )
+               {
+                m_sample.Ek = universe.kinetic_energy();
+                m_sample.Eu = universe.gravitational_energy();
+                if( m_sampling.is_energy_jump(m_E_ref, m_sample.Ek + m_sample.Eu) )
+                   {
+                    content = Sample::has_all;
+                   }
+               }
+            else if( content & Sample::has_energies )
+               {
+                m_sample.Ek = universe.kinetic_energy();
+                m_sample.Eu = universe.gravitational_energy();
+               }
+
+            if( content!=0 )
+               {
+                m_sample.time = universe.time();
+                m_sample.content = content;
+                if( content & Sample::has_bodies ) m_sample.bodies.assign(universe.bodies().begin(), universe.bodies().end());
+                else m_sample.bodies.clear();
+                if( content & Sample::has_cm ) m_sample.Cm = universe.center_of_mass();
+                if( content & Sample::has_energies ) m_E_ref = m_sample.Ek + m_sample.Eu;
+                sink.push(m_sample);
+               }
 
-            m_data.collect(t, universe.bodies(),
-                              universe.center_of_mass(),
-                              universe.kinetic_energy(),
-                              universe.gravitational_energy() );
+            if( m_checkpoint and m_steps % m_checkpoint_steps == 0 )
+               {
+                m_checkpoint->write(universe, run_state());
+               }
             t += dt;
            }
         while(t<T);
+        sink.finish();
        }
+
+ private:
+    static constexpr std::size_t run_state_size = sizeof(std::uint64_t) + sizeof(double);
 };
 
 
@@ -114,15 +224,115 @@ class Simulation final
 //         f << s.time << ',' << s.Ek << ',' << s.Eu << ',' << (s.Ek+s.Eu) << '\n';
 //    }
 //
-//    // Bodies position
-//    for( std::ptrdiff_t idx=0; [[maybe_unused]] const auto& body : universe.bodies() )
-//       {
-//        const std::string fname = fmt::format("body{}.txt",idx);
-//        std::ofstream f (fname, std::ios::out);
-//        if(!f.is_open()) throw std::runtime_error("Unable to open file " + fname);
-//        f << "time,body" << idx << ".x,body" << idx << ".y,body" << idx << ".z\n";
-//        for(const Simulation::Data::Sample& s : sim.data().samples())
-//            f << s.time << ',' << (s.bodies.begin()+idx)->position() << '\n';
-//        ++idx;
-//       }
+//    // Bodies position, a file for each
+//    tracks::collect(sim.data()).save_to_files("tracks");
 //}
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <filesystem> // std::filesystem::*
+#include <fstream> // std::ifstream
+#include "scenarios.hpp" // scenarios::uniform_disk
+static ut::suite<"Simulation"> simulation_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("Simulation::checkpoint_every zero steps") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test-none.chk").string();
+    std::filesystem::remove(fpath);
+    Universe universe(1.0);
+    universe.add_body(100, {0,0}, {0,0}).add_body(10, {100,0}, {0,1});
+    CheckpointWriter writer(fpath);
+    Simulation sim(10);
+    sim.checkpoint_every(0, writer);
+    sim.execute(universe, 1.0, 0.1);
+    writer.wait();
+    ut::expect( not std::filesystem::exists(fpath) );
+   };
+
+ut::test("Simulation restarted from a checkpoint") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test-restart.chk").string();
+    const double T = 8.0, dt = 0.125; // Exact sums of steps
+    sampling::Policy policy;
+    policy.bodies = sampling::Cadence::every_steps(7);
+    policy.energies = sampling::Cadence::every_steps(5);
+    policy.cm = sampling::Cadence::never();
+    policy.energy_jump = 1e-6;
+    const auto make_universe = [] { return scenarios::uniform_disk(40, 3); };
+
+    // Straight through
+    Universe straight = make_universe();
+    SimulationData straight_data(10'000);
+       {
+        Simulation sim;
+        sim.set_sampling(policy);
+        sim.execute(straight, T, dt, straight_data);
+       }
+
+    // Saved in the middle and restarted
+    Universe first_half = make_universe();
+    SimulationData split_data(10'000);
+       {
+        CheckpointWriter writer(fpath);
+        Simulation sim;
+        sim.set_sampling(policy);
+        sim.checkpoint_every(static_cast<std::size_t>(T/2/dt), writer);
+        sim.execute(first_half, T/2, dt, split_data);
+        writer.wait();
+       }
+    std::string run_state;
+    Universe second_half = Checkpoint::load(fpath, &run_state);
+       {
+        Simulation sim;
+        sim.set_sampling(policy);
+        sim.restore_run_state(run_state);
+        sim.execute(second_half, T/2, dt, split_data);
+       }
+    std::filesystem::remove(fpath);
+
+    ut::expect( second_half.bodies().size()<first_half.bodies().size() ); // Mergers after the restart
+    ut::expect( ut::fatal(split_data.size()==straight_data.size()) );
+    bool same = second_half.time()==straight.time();
+    for( std::size_t i=0; i<straight_data.size(); ++i )
+       {
+        const Sample& a = straight_data.sample(i);
+        const Sample& b = split_data.sample(i);
+        same = same and a.time==b.time and a.content==b.content and a.bodies.size()==b.bodies.size();
+        if( a.content & Sample::has_energies ) same = same and a.Ek==b.Ek and a.Eu==b.Eu;
+        for( std::size_t j=0; same and j<a.bodies.size(); ++j )
+           {
+            same = a.bodies[j].id()==b.bodies[j].id() and a.bodies[j].position()==b.bodies[j].position();
+           }
+       }
+    ut::expect( same );
+   };
+
+ut::test("TextFileSink") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.csv").string();
+    Universe universe(1.0);
+    universe.add_body(100, {0,0}, {0,0}).add_body(10, {100,0}, {0,1});
+       {
+        TextFileSink sink(fpath);
+        Simulation sim;
+        sim.execute(universe, 1.0, 0.25, sink);
+       }
+    std::ifstream f(fpath);
+    std::string line;
+    std::size_t rows = 0;
+    std::getline(f, line);
+    ut::expect( line=="time,bodies-xy-pos" );
+    while( std::getline(f, line) ) ++rows;
+    ut::expect( rows==4u );
+    std::filesystem::remove(fpath);
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,115 @@
+#pragma once
+//  ---------------------------------------------
+//  Lock-free single producer single consumer queue
+//  ---------------------------------------------
+#include <atomic>
+#include <bit> // std::bit_ceil
+#include <cstddef> // std::size_t
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////
+// Bounded ring: one thread pushes, another one pops.
+// The blocking variants sleep on the counters instead of spinning
+template<typename T> class SpscQueue final
+{
+ private:
+    std::vector<T> m_ring;
+    std::size_t m_mask; // Capacity-1
+    alignas(64) std::atomic<std::size_t> m_head{0}; // Next slot to write (own cache line)
+    alignas(64) std::atomic<std::size_t> m_tail{0}; // Next slot to read
+
+ public:
+    explicit SpscQueue(const std::size_t capacity)
+      : m_ring(std::bit_ceil(capacity<2 ? std::size_t{2} : capacity))
+      , m_mask(m_ring.size()-1)
+       {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_ring.size(); }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool try_push(const T& v) noexcept
+       {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if( head - m_tail.load(std::memory_order_acquire) > m_mask ) return false; // Full
+        m_ring[head & m_mask] = v;
+        m_head.store(head+1, std::memory_order_release);
+        m_head.notify_one();
+        return true;
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool try_pop(T& v) noexcept
+       {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if( tail==m_head.load(std::memory_order_acquire) ) return false; // Empty
+        v = m_ring[tail & m_mask];
+        m_tail.store(tail+1, std::memory_order_release);
+        m_tail.notify_one();
+        return true;
+       }
+
+    //-----------------------------------------------------------------------
+    void push(const T& v) noexcept
+       {
+        while( not try_push(v) )
+           {// Wait until the consumer moves
+            const std::size_t tail = m_tail.load(std::memory_order_acquire);
+            if( m_head.load(std::memory_order_relaxed) - tail > m_mask ) m_tail.wait(tail, std::memory_order_acquire);
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] T pop() noexcept
+       {
+        T v;
+        while( not try_pop(v) )
+           {// Wait until the producer moves
+            const std::size_t head = m_head.load(std::memory_order_acquire);
+            if( head==m_tail.load(std::memory_order_relaxed) ) m_head.wait(head, std::memory_order_acquire);
+           }
+        return v;
+       }
+};
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <thread> // std::jthread
+static ut::suite<"SpscQueue"> spsc_queue_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("SpscQueue::try_push and try_pop") = []
+   {
+    SpscQueue<int> q(3);
+    ut::expect( q.capacity()==4u );
+    int v = 0;
+    ut::expect( not q.try_pop(v) );
+    bool pushed = true;
+    for( int i=1; i<=4; ++i ) pushed = pushed and q.try_push(i);
+    ut::expect( pushed and not q.try_push(5) );
+    bool in_order = true;
+    for( int i=1; i<=4; ++i ) in_order = in_order and q.try_pop(v) and v==i;
+    ut::expect( in_order and not q.try_pop(v) );
+   };
+
+ut::test("SpscQueue between two threads") = []
+   {
+    constexpr int n = 100'000;
+    SpscQueue<int> q(16);
+    std::jthread producer([&q]() noexcept { for( int i=0; i<n; ++i ) q.push(i); });
+    bool in_order = true;
+    for( int i=0; i<n; ++i ) in_order = in_order and q.pop()==i;
+    ut::expect( in_order );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
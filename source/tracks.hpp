@@ -0,0 +1,153 @@
+#pragma once
+//  ---------------------------------------------
+//  Per-body time series of positions
+//  ---------------------------------------------
+//  The samples come body after body at each time, while a track needs a
+//  body at all times: the positions are stored body-major as they arrive,
+//  so each track is contiguous and is written out in one go
+#include <charconv> // std::to_chars
+#include <cstdint> // std::uint64_t
+#include <filesystem> // std::filesystem::path
+#include <fstream>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sample.hpp" // Sample, SampleSink
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace tracks //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// A body exists from when is added until it merges or escapes, so its
+// track spans a contiguous range of samples
+struct Track final
+{
+    std::uint64_t id;
+    std::size_t first_sample; // Index in the times
+    std::vector<Universe::Vect> positions;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+class Sink final : public SampleSink
+{
+ private:
+    std::vector<double> m_times; // Of the samples with bodies
+    std::vector<Track> m_tracks; // Sorted by id
+
+ public:
+    void push(const Sample& s) override
+       {
+        if( not s.has(Sample::has_bodies) ) return;
+        const std::size_t sample_idx = m_times.size();
+        m_times.push_back(s.time);
+
+        // The ids come in increasing order, like in Universe::bodies()
+        std::size_t cursor = 0;
+        for( const auto& body : s.bodies )
+           {
+            while( cursor<m_tracks.size() and m_tracks[cursor].id<body.id() ) ++cursor;
+            if( cursor==m_tracks.size() or m_tracks[cursor].id!=body.id() )
+               {// A new body, always with the greatest id
+                m_tracks.push_back({body.id(), sample_idx, {}});
+                cursor = m_tracks.size()-1;
+               }
+            m_tracks[cursor].positions.push_back(body.position());
+           }
+       }
+
+    [[nodiscard]] const std::vector<double>& times() const noexcept { return m_times; }
+    [[nodiscard]] const std::vector<Track>& tracks() const noexcept { return m_tracks; }
+
+    [[nodiscard]] double time_of(const Track& track, const std::size_t i) const noexcept
+       {
+        return m_times[track.first_sample + i];
+       }
+
+    void clear() noexcept
+       {
+        m_times.clear();
+        m_tracks.clear();
+       }
+
+    //-----------------------------------------------------------------------
+    // One file per body named body<id>.csv, columns time,x,y
+    void save_to_files(const std::filesystem::path& dir) const
+       {
+        std::filesystem::create_directories(dir);
+        std::vector<char> buf;
+        for( const Track& track : m_tracks )
+           {
+            buf.clear();
+            append(buf, "time,x,y\n");
+            for( std::size_t i=0; i<track.positions.size(); ++i ) append_row(buf, time_of(track,i), track.positions[i]);
+            write(buf, (dir / ("body" + std::to_string(track.id) + ".csv")).string());
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    // Just one file, columns id,time,x,y, body after body
+    void save_to_file(const std::string& fpath) const
+       {
+        std::vector<char> buf;
+        append(buf, "id,time,x,y\n");
+        for( const Track& track : m_tracks )
+           {
+            for( std::size_t i=0; i<track.positions.size(); ++i )
+               {
+                append_number(buf, track.id);
+                buf.push_back(',');
+                append_row(buf, time_of(track,i), track.positions[i]);
+               }
+           }
+        write(buf, fpath);
+       }
+
+ private:
+    static void append(std::vector<char>& buf, const std::string_view sv)
+       {
+        buf.insert(buf.end(), sv.begin(), sv.end());
+       }
+
+    template<typename T> static void append_number(std::vector<char>& buf, const T v)
+       {
+        char str[32];
+        char* const end = std::to_chars(str, str+sizeof(str), v).ptr;
+        buf.insert(buf.end(), str, end);
+       }
+
+    static void append_row(std::vector<char>& buf, const double t, const Universe::Vect& pos)
+       {
+        append_number(buf, t);
+        buf.push_back(',');
+        append_number(buf, pos.x);
+        buf.push_back(',');
+        append_number(buf, pos.y);
+        buf.push_back('\n');
+       }
+
+    static void write(const std::vector<char>& buf, const std::string& fpath)
+       {
+        std::ofstream f(fpath, std::ios::out | std::ios::binary);
+        if(!f.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+        f.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+       }
+};
+
+
+//----------------------------------------------------------------------
+// Transposes a random access collection of samples (having size() and
+// sample(i)) in a single pass
+template<typename Samples>
+[[nodiscard]] Sink collect(const Samples& samples)
+{
+    Sink sink;
+    for( std::size_t i=0; i<samples.size(); ++i ) sink.push(samples.sample(i));
+    return sink;
+}
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
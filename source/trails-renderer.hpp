@@ -0,0 +1,119 @@
+#pragma once
+//  ---------------------------------------------
+//  Draws the recent path of the bodies
+//  ---------------------------------------------
+#include <algorithm> // std::min
+#include <cstdint> // std::uint64_t
+#include <vector>
+
+#include <SFML/Graphics.hpp> // sf::*
+
+#include "universe.hpp" // Universe
+
+
+////////////////////////////////////////////////////////////////////////
+// Each body has a ring buffer of its last positions: the memory is
+// bounded by bodies×length and recording a step costs O(N). All the
+// trails go in a single line strip, joined by transparent segments,
+// fading from the oldest position to the newest
+class TrailsRenderer final : public sf::Drawable
+{
+    struct Trail final
+       {
+        std::uint64_t id; // Of the body
+        std::size_t slot; // Of the ring buffer in m_points
+        std::size_t head; // Next position to write
+        std::size_t count; // Positions stored
+       };
+
+ private:
+    std::size_t m_length; // Positions of each trail
+    sf::Color m_color; // Of the newest position
+    std::vector<sf::Vector2f> m_points; // The ring buffers, one after another
+    std::vector<std::size_t> m_free_slots; // Of bodies no more present
+    std::vector<Trail> m_trails, m_next_trails; // Sorted by id
+    sf::VertexArray m_vertices{sf::LineStrip};
+
+ public:
+    explicit TrailsRenderer(const std::size_t length =200, const sf::Color color ={120,140,200,160}) noexcept
+      : m_length(length>1 ? length : 2)
+      , m_color(color)
+       {}
+
+    [[nodiscard]] std::size_t trails_count() const noexcept { return m_trails.size(); }
+    [[nodiscard]] std::size_t vertices_count() const noexcept { return m_vertices.getVertexCount(); }
+
+    void clear() noexcept
+       {
+        m_points.clear();
+        m_free_slots.clear();
+        m_trails.clear();
+        m_vertices.clear();
+       }
+
+    //-----------------------------------------------------------------------
+    // To be called once per step, bodies sorted by id like in Universe::bodies()
+    void record(const std::vector<Universe::Body>& bodies)
+       {
+        m_next_trails.clear();
+        std::size_t cursor = 0;
+        for( const auto& body : bodies )
+           {
+            while( cursor<m_trails.size() and m_trails[cursor].id<body.id() )
+               {// The body is gone
+                m_free_slots.push_back( m_trails[cursor++].slot );
+               }
+            Trail trail;
+            if( cursor<m_trails.size() and m_trails[cursor].id==body.id() ) trail = m_trails[cursor++];
+            else trail = {body.id(), acquire_slot(), 0, 0};
+
+            m_points[trail.slot*m_length + trail.head] = { static_cast<float>(body.position().x), static_cast<float>(body.position().y) };
+            trail.head = (trail.head + 1) % m_length;
+            trail.count = std::min(trail.count + 1, m_length);
+            m_next_trails.push_back(trail);
+           }
+        for( ; cursor<m_trails.size(); ++cursor ) m_free_slots.push_back( m_trails[cursor].slot );
+        m_trails.swap(m_next_trails);
+        build_vertices();
+       }
+
+ private:
+    [[nodiscard]] std::size_t acquire_slot()
+       {
+        if( not m_free_slots.empty() )
+           {
+            const std::size_t slot = m_free_slots.back();
+            m_free_slots.pop_back();
+            return slot;
+           }
+        const std::size_t slot = m_points.size() / m_length;
+        m_points.resize(m_points.size() + m_length);
+        return slot;
+       }
+
+    void build_vertices()
+       {
+        m_vertices.clear();
+        sf::Color transparent = m_color;
+        transparent.a = 0;
+        for( const Trail& trail : m_trails )
+           {
+            if( trail.count<2 ) continue;
+            const sf::Vector2f* const ring = m_points.data() + trail.slot*m_length;
+            const std::size_t oldest = (trail.head + m_length - trail.count) % m_length;
+            m_vertices.append( sf::Vertex(ring[oldest], transparent) ); // Invisible junction
+            sf::Color col = m_color;
+            for( std::size_t i=0; i<trail.count; ++i )
+               {
+                col.a = static_cast<sf::Uint8>( (m_color.a * (i+1)) / trail.count );
+                m_vertices.append( sf::Vertex(ring[(oldest + i) % m_length], col) );
+               }
+            m_vertices.append( sf::Vertex(ring[(oldest + trail.count - 1) % m_length], transparent) );
+           }
+       }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+       {
+        target.draw(m_vertices, states);
+       }
+};
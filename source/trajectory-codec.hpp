@@ -0,0 +1,358 @@
+#pragma once
+//  ---------------------------------------------
+//  Lossy compressed trajectories (positions only)
+//  ---------------------------------------------
+//  Positions are quantized to a step q, predicted from the previous two
+//  samples of the same body (linear extrapolation), and the residuals
+//  stored as zigzag varints: slow or regular motion costs one byte or two
+//  per coordinate. The error on each coordinate is at most q/2.
+//  Layout (native endianness for the fixed size fields):
+//    header "NBQTRJ01" f64:q
+//    samples u64:block size f64:time varint:n
+//            n × varint:id delta, n × (zigzag varint:rx, zigzag varint:ry)
+#include <cmath> // std::llround
+#include <cstdint> // std::uint64_t, std::int64_t
+#include <cstring> // std::memcpy
+#include <fstream>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sample.hpp" // Sample, SampleSink
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace qtraj //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+inline constexpr std::string_view magic{"NBQTRJ01"};
+
+//----------------------------------------------------------------------
+[[nodiscard]] constexpr std::uint64_t zigzag(const std::int64_t v) noexcept
+{
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+//----------------------------------------------------------------------
+[[nodiscard]] constexpr std::int64_t unzigzag(const std::uint64_t u) noexcept
+{
+    return static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1);
+}
+
+//----------------------------------------------------------------------
+inline void put_varint(std::vector<char>& buf, std::uint64_t v)
+{
+    while( v>=0x80 )
+       {
+        buf.push_back( static_cast<char>((v & 0x7F) | 0x80) );
+        v >>= 7;
+       }
+    buf.push_back( static_cast<char>(v) );
+}
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline std::uint64_t get_varint(const char*& p, const char* const end)
+{
+    std::uint64_t v = 0;
+    for( unsigned int shift=0; p<end and shift<64; shift+=7 )
+       {
+        const auto byte = static_cast<std::uint8_t>(*p++);
+        v |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if( (byte & 0x80)==0 ) return v;
+       }
+    throw std::runtime_error("Corrupted compressed trajectory");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// The quantized history of bodies, identical in encoder and decoder
+class Predictor final
+{
+    struct Track final
+       {
+        std::uint64_t id;
+        std::int64_t x, y; // Last quantized position
+        std::int64_t dx, dy; // Last quantized displacement
+       };
+
+ private:
+    std::vector<Track> m_prev, m_curr; // Sorted by id
+    std::size_t m_cursor = 0; // Matching position in m_prev
+
+ public:
+    void begin_sample() noexcept
+       {
+        m_curr.clear();
+        m_cursor = 0;
+       }
+
+    // The ids must come in increasing order, like in Universe::bodies()
+    void predict(const std::uint64_t id, std::int64_t& px, std::int64_t& py) noexcept
+       {
+        while( m_cursor<m_prev.size() and m_prev[m_cursor].id<id ) ++m_cursor;
+        if( m_cursor<m_prev.size() and m_prev[m_cursor].id==id )
+           {
+            const Track& tr = m_prev[m_cursor];
+            px = tr.x + tr.dx;
+            py = tr.y + tr.dy;
+           }
+        else
+           {// A new body
+            px = py = 0;
+           }
+       }
+
+    void record(const std::uint64_t id, const std::int64_t x, const std::int64_t y)
+       {
+        const bool known = m_cursor<m_prev.size() and m_prev[m_cursor].id==id;
+        const std::int64_t dx = known ? x - m_prev[m_cursor].x : 0;
+        const std::int64_t dy = known ? y - m_prev[m_cursor].y : 0;
+        m_curr.push_back({id, x, y, dx, dy});
+       }
+
+    void end_sample() noexcept { m_prev.swap(m_curr); }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+class Encoder final : public SampleSink
+{
+ private:
+    std::string m_fpath;
+    std::ofstream m_file;
+    double m_q; // Quantization step [<space>]
+    Predictor m_predictor;
+    std::vector<char> m_buf;
+
+ public:
+    //                                              Max error relative to domain    Domain size [<space>]
+    Encoder(const std::string& fpath, const double tolerance, const double domain_size)
+      : m_fpath(fpath)
+      , m_file(fpath, std::ios::out | std::ios::binary)
+      , m_q(2.0 * tolerance * domain_size)
+       {
+        if(!m_file.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+        if( not (m_q>0.0) ) throw std::runtime_error("Compressed trajectory tolerance must be positive");
+        m_file.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+        m_file.write(reinterpret_cast<const char*>(&m_q), sizeof(m_q));
+        if(!m_file) throw std::runtime_error("Unable to write " + fpath);
+       }
+
+    [[nodiscard]] double quantum() const noexcept { return m_q; }
+
+    void push(const Sample& s) override
+       {
+        if( not s.has(Sample::has_bodies) ) return;
+
+        m_buf.assign(8, '\0'); // Block size, set at the end
+        m_buf.resize(16);
+        std::memcpy(m_buf.data()+8, &s.time, sizeof(s.time));
+        put_varint(m_buf, s.bodies.size());
+        std::uint64_t prev_id = 0;
+        for( const auto& body : s.bodies )
+           {
+            put_varint(m_buf, body.id() - prev_id);
+            prev_id = body.id();
+           }
+
+        m_predictor.begin_sample();
+        for( const auto& body : s.bodies )
+           {
+            const std::int64_t x = std::llround(body.position().x / m_q);
+            const std::int64_t y = std::llround(body.position().y / m_q);
+            std::int64_t px, py;
+            m_predictor.predict(body.id(), px, py);
+            put_varint(m_buf, zigzag(x - px));
+            put_varint(m_buf, zigzag(y - py));
+            m_predictor.record(body.id(), x, y);
+           }
+        m_predictor.end_sample();
+
+        const std::uint64_t block_size = m_buf.size();
+        std::memcpy(m_buf.data(), &block_size, sizeof(block_size));
+        if( not m_file.write(m_buf.data(), static_cast<std::streamsize>(m_buf.size())) ) throw std::runtime_error("Unable to write " + m_fpath);
+       }
+
+    void finish() override
+       {
+        if( not m_file.flush() ) throw std::runtime_error("Unable to write " + m_fpath);
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+struct Frame final
+{
+    double time = 0.0;
+    std::vector<std::uint64_t> ids;
+    std::vector<double> x, y;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reads the samples in sequence
+class Decoder final
+{
+ private:
+    std::ifstream m_file;
+    double m_q = 0.0;
+    Predictor m_predictor;
+    std::vector<char> m_buf;
+    std::uint64_t m_bytes_left = 0; // Not yet read
+
+ public:
+    explicit Decoder(const std::string& fpath)
+      : m_file(fpath, std::ios::in | std::ios::binary | std::ios::ate)
+       {
+        if(!m_file.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+        const auto file_size = static_cast<std::uint64_t>(m_file.tellg());
+        m_file.seekg(0);
+        std::string file_magic(magic.size(), '\0');
+        m_file.read(file_magic.data(), static_cast<std::streamsize>(file_magic.size()));
+        m_file.read(reinterpret_cast<char*>(&m_q), sizeof(m_q));
+        if( not m_file or file_magic!=magic ) throw std::runtime_error(fpath + " is not a compressed trajectory");
+        m_bytes_left = file_size - magic.size() - sizeof(m_q);
+       }
+
+    [[nodiscard]] double quantum() const noexcept { return m_q; }
+
+    // Returns false at the end of file
+    [[nodiscard]] bool next(Frame& frame)
+       {
+        std::uint64_t block_size = 0;
+        if( m_bytes_left<sizeof(block_size) or not m_file.read(reinterpret_cast<char*>(&block_size), sizeof(block_size)) ) return false;
+        if( block_size<16 ) throw std::runtime_error("Corrupted compressed trajectory");
+        if( block_size>m_bytes_left ) return false; // Truncated (or corrupted size, not worth allocating)
+        m_bytes_left -= block_size;
+        m_buf.resize(static_cast<std::size_t>(block_size) - 8);
+        if( not m_file.read(m_buf.data(), static_cast<std::streamsize>(m_buf.size())) ) return false;
+
+        const char* p = m_buf.data();
+        const char* const end = p + m_buf.size();
+        std::memcpy(&frame.time, p, sizeof(frame.time));
+        p += sizeof(frame.time);
+        const auto n = static_cast<std::size_t>(get_varint(p, end));
+        if( n>static_cast<std::size_t>(end-p) ) throw std::runtime_error("Corrupted compressed trajectory"); // At least a byte per id
+        frame.ids.resize(n);
+        std::uint64_t id = 0;
+        for( auto& frame_id : frame.ids ) frame_id = (id += get_varint(p, end));
+
+        frame.x.resize(n);
+        frame.y.resize(n);
+        m_predictor.begin_sample();
+        for( std::size_t i=0; i<n; ++i )
+           {
+            std::int64_t px, py;
+            m_predictor.predict(frame.ids[i], px, py);
+            const std::int64_t x = px + unzigzag(get_varint(p, end));
+            const std::int64_t y = py + unzigzag(get_varint(p, end));
+            m_predictor.record(frame.ids[i], x, y);
+            frame.x[i] = static_cast<double>(x) * m_q;
+            frame.y[i] = static_cast<double>(y) * m_q;
+           }
+        m_predictor.end_sample();
+        return true;
+       }
+};
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <filesystem> // std::filesystem::*
+#include <limits> // std::numeric_limits
+static ut::suite<"qtraj"> qtraj_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("qtraj::zigzag") = []
+   {
+    ut::expect( qtraj::zigzag(0)==0u and qtraj::zigzag(-1)==1u and qtraj::zigzag(1)==2u and qtraj::zigzag(-2)==3u );
+    bool round_trip = true;
+    for( const std::int64_t v : {std::int64_t{0}, std::int64_t{1}, std::int64_t{-1}, std::int64_t{123456789}, std::int64_t{-987654321},
+                                 std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()} )
+       {
+        round_trip = round_trip and qtraj::unzigzag(qtraj::zigzag(v))==v;
+       }
+    ut::expect( round_trip );
+   };
+
+ut::test("qtraj::varint") = []
+   {
+    const std::uint64_t values[] = { 0u, 1u, 127u, 128u, 16383u, 16384u, 1u<<31, std::numeric_limits<std::uint64_t>::max() };
+    std::vector<char> buf;
+    for( const std::uint64_t v : values ) qtraj::put_varint(buf, v);
+    ut::expect( buf.size()==1u+1u+1u+2u+2u+3u+5u+10u );
+    const char* p = buf.data();
+    const char* const end = buf.data() + buf.size();
+    bool round_trip = true;
+    for( const std::uint64_t v : values ) round_trip = round_trip and qtraj::get_varint(p, end)==v;
+    ut::expect( round_trip and p==end );
+
+    const char unterminated[] = { '\x80', '\x80' };
+    const char* q = unterminated;
+    ut::expect( ut::throws([&]{ [[maybe_unused]] const auto v = qtraj::get_varint(q, unterminated+2); }) );
+   };
+
+ut::test("qtraj::Encoder and Decoder") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.qtraj").string();
+    double q = 0.0;
+       {
+        qtraj::Encoder encoder(fpath, 1e-4, 1000.0);
+        q = encoder.quantum();
+        Sample s{};
+        for( int i=0; i<20; ++i )
+           {
+            s.time = static_cast<double>(i);
+            s.bodies.clear();
+            s.bodies.emplace_back(1.0, Universe::Vect{10.0*i, 3.3*i*i}, Universe::Vect{}, 1);
+            if( i<10 ) s.bodies.emplace_back(1.0, Universe::Vect{-5.5*i, 7.1}, Universe::Vect{}, 4);
+            s.bodies.emplace_back(1.0, Universe::Vect{0.123*i, -400.0}, Universe::Vect{}, 9);
+            encoder.push(s);
+           }
+       }
+
+    qtraj::Decoder decoder(fpath);
+    qtraj::Frame frame;
+    const double max_error = 0.5*q*(1.0 + 1e-9); // Half a step, ties included
+    int frames = 0;
+    bool exact_ids = true, within_tolerance = true;
+    while( decoder.next(frame) )
+       {
+        const double i = frame.time;
+        exact_ids = exact_ids and frame.ids.size()==(i<10 ? 3u : 2u) and frame.ids.front()==1u and frame.ids.back()==9u;
+        within_tolerance = within_tolerance and std::abs(frame.x.front() - 10.0*i)<=max_error and std::abs(frame.y.front() - 3.3*i*i)<=max_error;
+        ++frames;
+       }
+    ut::expect( frames==20 and exact_ids and within_tolerance );
+
+    // A corrupted block size must not be trusted
+       {
+        std::fstream f(fpath, std::ios::in | std::ios::out | std::ios::binary);
+        const std::uint64_t huge = std::uint64_t{1} << 50;
+        f.seekp(16);
+        f.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+       }
+    qtraj::Decoder corrupted(fpath);
+    ut::expect( not corrupted.next(frame) );
+    std::filesystem::remove(fpath);
+   };
+
+ut::test("qtraj::Encoder on a full disk") = []
+   {
+    if( not std::filesystem::exists("/dev/full") ) return;
+    qtraj::Encoder encoder("/dev/full", 1e-4, 1000.0);
+    Sample s{};
+    s.bodies.emplace_back(1.0, Universe::Vect{}, Universe::Vect{}, 1);
+    ut::expect( ut::throws([&]{ for( int i=0; i<10'000; ++i ) encoder.push(s); encoder.finish(); }) );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,611 @@
+#pragma once
+//  ---------------------------------------------
+//  Binary columnar trajectory file
+//  ---------------------------------------------
+//  Layout (native endianness, everything 8 bytes aligned):
+//    header  "NBTRAJ01" u32:fields u32:value size (4|8) f64:dt u64:N
+//    samples u64:block size f64:time u64:content u64:n f64:Ek f64:Eu f64:Cm.x f64:Cm.y
+//            (NaN the quantities not in content)
+//            then the selected fields, each a contiguous column of n values
+//            (ids are always u64), padded to 8 bytes
+//    index   S × (f64:time u64:offset u64:content) u64:S u64:index offset "NBTRJIDX"
+//  The index is written when finished: a file without it (an interrupted
+//  run) is still readable, scanning the blocks
+#include <algorithm> // std::ranges::upper_bound
+#include <initializer_list>
+#include <cstdint> // std::uint32_t, std::uint64_t
+#include <cstring> // std::memcpy
+#include <fstream>
+#include <limits> // std::numeric_limits
+#include <span>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sample.hpp" // Sample, SampleSink
+#include "mapped-file.hpp" // MappedFile
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace trajectory //::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+inline constexpr std::string_view magic{"NBTRAJ01"};
+inline constexpr std::string_view index_magic{"NBTRJIDX"};
+inline constexpr std::size_t header_size = 8 + 4 + 4 + 8 + 8;
+inline constexpr std::size_t sample_header_size = 8*8;
+inline constexpr std::size_t index_entry_size = 8 + 8 + 8;
+inline constexpr std::size_t index_trailer_size = 8 + 8 + 8;
+
+// The per-body quantities
+enum class Field : std::uint32_t
+{
+    id     = 1u << 0,
+    mass   = 1u << 1,
+    x      = 1u << 2,
+    y      = 1u << 3,
+    vx     = 1u << 4,
+    vy     = 1u << 5
+};
+inline constexpr Field all_fields[] = { Field::id, Field::mass, Field::x, Field::y, Field::vx, Field::vy };
+
+//----------------------------------------------------------------------
+class Fields final
+{
+ private:
+    std::uint32_t m_bits = 0;
+
+ public:
+    constexpr Fields() noexcept = default;
+    constexpr explicit Fields(const std::uint32_t bits) noexcept : m_bits(bits) {}
+    constexpr Fields(std::initializer_list<Field> lst) noexcept
+       {
+        for( const Field f : lst ) m_bits |= static_cast<std::uint32_t>(f);
+       }
+
+    [[nodiscard]] constexpr std::uint32_t bits() const noexcept { return m_bits; }
+    [[nodiscard]] constexpr bool contains(const Field f) const noexcept { return (m_bits & static_cast<std::uint32_t>(f))!=0; }
+    [[nodiscard]] constexpr bool is_empty() const noexcept { return m_bits==0; }
+};
+inline constexpr Fields positions{ Field::x, Field::y };
+inline constexpr Fields full_state{ Field::id, Field::mass, Field::x, Field::y, Field::vx, Field::vy };
+
+//----------------------------------------------------------------------
+[[nodiscard]] constexpr std::size_t padded(const std::size_t n) noexcept { return (n + 7u) & ~std::size_t{7u}; }
+
+//----------------------------------------------------------------------
+[[nodiscard]] constexpr std::size_t column_bytes(const Field f, const std::size_t n, const std::size_t value_size) noexcept
+{
+    return padded( n * (f==Field::id ? sizeof(std::uint64_t) : value_size) );
+}
+
+//----------------------------------------------------------------------
+[[nodiscard]] constexpr std::size_t sample_block_size(const Fields fields, const std::size_t n, const std::size_t value_size) noexcept
+{
+    std::size_t block_size = sample_header_size;
+    for( const Field f : all_fields )
+       {
+        if( fields.contains(f) ) block_size += column_bytes(f, n, value_size);
+       }
+    return block_size;
+}
+
+//----------------------------------------------------------------------
+[[nodiscard]] inline double get(const Universe::Body& body, const Field f) noexcept
+{
+    switch( f )
+       {
+        case Field::mass: return body.mass();
+        case Field::x: return body.position().x;
+        case Field::y: return body.position().y;
+        case Field::vx: return body.speed().x;
+        case Field::vy: return body.speed().y;
+        case Field::id: break;
+       }
+    return 0.0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+class Writer final : public SampleSink
+{
+ private:
+    static constexpr double not_sampled = std::numeric_limits<double>::quiet_NaN();
+    std::string m_fpath;
+    std::ofstream m_file;
+    Fields m_fields;
+    std::size_t m_value_size;
+    std::vector<char> m_buf; // Block being encoded
+    std::uint64_t m_offset = 0; // Bytes written
+    std::vector<double> m_times; // Of each sample
+    std::vector<std::uint64_t> m_offsets; // Of each sample
+    std::vector<std::uint8_t> m_contents; // Of each sample
+    bool m_closed = false;
+
+ public:
+    //                                                     Time step       Selected fields                    4:float32 8:float64
+    Writer(const std::string& fpath, const std::size_t N, const double dt, const Fields fields =full_state, const std::size_t value_size =8)
+      : m_fpath(fpath)
+      , m_file(fpath, std::ios::out | std::ios::binary)
+      , m_fields(fields)
+      , m_value_size(value_size==4 ? 4 : 8)
+       {
+        if(!m_file.is_open()) throw std::runtime_error("Unable to open file " + fpath);
+        m_buf.resize(header_size);
+        char* p = m_buf.data();
+        std::memcpy(p, magic.data(), magic.size()); p += magic.size();
+        put<std::uint32_t>(p, m_fields.bits());
+        put<std::uint32_t>(p, static_cast<std::uint32_t>(m_value_size));
+        put<double>(p, dt);
+        put<std::uint64_t>(p, N);
+        write_buf();
+       }
+
+    ~Writer() override
+       {// Call close() to know if the index was written
+        try{ close(); }
+        catch(...) {}
+       }
+
+    void push(const Sample& s) override
+       {
+        if( m_closed ) throw std::runtime_error("Trajectory file already closed");
+        const std::size_t n = s.bodies.size();
+        const std::size_t block_size = sample_block_size(m_fields, n, m_value_size);
+        m_buf.assign(block_size, '\0');
+        m_times.push_back(s.time);
+        m_offsets.push_back(m_offset);
+        m_contents.push_back(s.content);
+
+        char* p = m_buf.data();
+        put<std::uint64_t>(p, block_size);
+        put<double>(p, s.time);
+        put<std::uint64_t>(p, s.content);
+        put<std::uint64_t>(p, n);
+        const bool has_energies = s.has(Sample::has_energies);
+        const bool has_cm = s.has(Sample::has_cm);
+        put<double>(p, has_energies ? s.Ek : not_sampled);
+        put<double>(p, has_energies ? s.Eu : not_sampled);
+        put<double>(p, has_cm ? s.Cm.x : not_sampled);
+        put<double>(p, has_cm ? s.Cm.y : not_sampled);
+        for( const Field f : all_fields )
+           {
+            if( not m_fields.contains(f) ) continue;
+            char* col = p;
+            if( f==Field::id )
+               {
+                for( const auto& body : s.bodies ) put<std::uint64_t>(col, body.id());
+               }
+            else if( m_value_size==4 )
+               {
+                for( const auto& body : s.bodies ) put<float>(col, static_cast<float>(get(body,f)));
+               }
+            else
+               {
+                for( const auto& body : s.bodies ) put<double>(col, get(body,f));
+               }
+            p += column_bytes(f, n, m_value_size);
+           }
+        write_buf();
+       }
+
+    void finish() override
+       {
+        if( not m_file.flush() ) throw std::runtime_error("Unable to write " + m_fpath);
+       }
+
+    // Appends the index, no more samples can be pushed
+    void close()
+       {
+        if( not m_closed )
+           {
+            m_closed = true;
+            const std::uint64_t index_offset = m_offset;
+            m_buf.resize(index_entry_size*m_times.size() + index_trailer_size);
+            char* p = m_buf.data();
+            for( std::size_t i=0; i<m_times.size(); ++i )
+               {
+                put<double>(p, m_times[i]);
+                put<std::uint64_t>(p, m_offsets[i]);
+                put<std::uint64_t>(p, m_contents[i]);
+               }
+            put<std::uint64_t>(p, m_times.size());
+            put<std::uint64_t>(p, index_offset);
+            std::memcpy(p, index_magic.data(), index_magic.size());
+            write_buf();
+            m_file.close();
+            if( m_file.fail() ) throw std::runtime_error("Unable to write " + m_fpath);
+           }
+       }
+
+ private:
+    template<typename T> static void put(char*& p, const T v) noexcept
+       {
+        std::memcpy(p, &v, sizeof(T));
+        p += sizeof(T);
+       }
+
+    void write_buf()
+       {
+        if( not m_file.write(m_buf.data(), static_cast<std::streamsize>(m_buf.size())) ) throw std::runtime_error("Unable to write " + m_fpath);
+        m_offset += m_buf.size();
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// A sample in a mapped file, the columns are views of the file content
+class SampleView final
+{
+ private:
+    const std::byte* m_block;
+    Fields m_fields;
+    std::size_t m_value_size;
+
+ public:
+    SampleView(const std::byte* block, const Fields fields, const std::size_t value_size) noexcept
+      : m_block(block)
+      , m_fields(fields)
+      , m_value_size(value_size)
+       {}
+
+    [[nodiscard]] double time() const noexcept { return get<double>(1); }
+    [[nodiscard]] bool has(const std::uint8_t what) const noexcept { return (get<std::uint64_t>(2) & what)==what; } // Sample::has_*
+    [[nodiscard]] std::size_t size() const noexcept { return static_cast<std::size_t>(get<std::uint64_t>(3)); }
+    [[nodiscard]] double Ek() const noexcept { return get<double>(4); }
+    [[nodiscard]] double Eu() const noexcept { return get<double>(5); }
+    [[nodiscard]] Universe::Vect Cm() const noexcept { return {get<double>(6), get<double>(7)}; }
+
+    // T must be std::uint64_t for ids, otherwise float or double
+    // according to the file precision
+    template<typename T> [[nodiscard]] std::span<const T> column(const Field f) const
+       {
+        if( not m_fields.contains(f) ) throw std::runtime_error("Field not present in trajectory file");
+        if( sizeof(T)!=(f==Field::id ? sizeof(std::uint64_t) : m_value_size) ) throw std::runtime_error("Wrong type for trajectory field");
+        const std::size_t n = size();
+        const std::byte* p = m_block + sample_header_size;
+        for( const Field other : all_fields )
+           {
+            if( other==f ) break;
+            if( m_fields.contains(other) ) p += column_bytes(other, n, m_value_size);
+           }
+        // The writer keeps the columns aligned to 8 bytes in the file
+        return { reinterpret_cast<const T*>(p), n };
+       }
+
+ private:
+    template<typename T> [[nodiscard]] T get(const std::size_t slot) const noexcept
+       {
+        T v;
+        std::memcpy(&v, m_block + slot*8, sizeof(T));
+        return v;
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+class Reader final
+{
+ private:
+    MappedFile m_file;
+    Fields m_fields;
+    std::size_t m_value_size = 8;
+    double m_dt = 0.0;
+    std::size_t m_N = 0;
+    std::vector<double> m_times; // Of each sample
+    std::vector<std::size_t> m_offsets; // Where each sample begins
+    std::vector<double> m_bodies_times; // Of the samples having bodies
+    std::vector<std::size_t> m_bodies_samples; // Indexes of the samples having bodies
+
+ public:
+    explicit Reader(const std::string& fpath)
+      : m_file(fpath)
+       {
+        const auto bytes = m_file.bytes();
+        if( bytes.size()<header_size or std::string_view(reinterpret_cast<const char*>(bytes.data()), magic.size())!=magic )
+           {
+            throw std::runtime_error(fpath + " is not a trajectory file");
+           }
+        const std::byte* p = bytes.data() + magic.size();
+        m_fields = Fields(get<std::uint32_t>(p));
+        m_value_size = get<std::uint32_t>(p);
+        if( m_value_size!=4 and m_value_size!=8 ) throw std::runtime_error(fpath + ": invalid value size " + std::to_string(m_value_size));
+        m_dt = get<double>(p);
+        m_N = static_cast<std::size_t>(get<std::uint64_t>(p));
+
+        if( not read_index(fpath) )
+           {// Just the block headers are touched
+            std::size_t offset = header_size;
+            while( offset + sample_header_size <= bytes.size() )
+               {
+                p = bytes.data() + offset;
+                const auto block_size = static_cast<std::size_t>(get<std::uint64_t>(p));
+                if( block_size<sample_header_size or offset + block_size > bytes.size() ) break; // Truncated
+                check_block(offset, fpath);
+                const double time = get<double>(p);
+                add_entry(time, offset, get<std::uint64_t>(p));
+                offset += block_size;
+               }
+           }
+       }
+
+    [[nodiscard]] Fields fields() const noexcept { return m_fields; }
+    [[nodiscard]] std::size_t value_size() const noexcept { return m_value_size; }
+    [[nodiscard]] double dt() const noexcept { return m_dt; }
+    [[nodiscard]] std::size_t initial_bodies_count() const noexcept { return m_N; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_offsets.size(); }
+    [[nodiscard]] bool empty() const noexcept { return m_offsets.empty(); }
+    [[nodiscard]] double time_of(const std::size_t i) const noexcept { return m_times[i]; }
+
+    [[nodiscard]] SampleView sample(const std::size_t i) const noexcept
+       {
+        return { m_file.bytes().data() + m_offsets[i], m_fields, m_value_size };
+       }
+
+    //-----------------------------------------------------------------------
+    // The searches by time consider just the samples having bodies,
+    // the others may be many (energies sampled at each step)
+    [[nodiscard]] bool has_bodies() const noexcept { return not m_bodies_samples.empty(); }
+
+    // The last sample with bodies not after t (the first one if t precedes
+    // them all, 0 if none has bodies)
+    [[nodiscard]] std::size_t index_at(const double t) const noexcept
+       {
+        return m_bodies_samples.empty() ? 0 : m_bodies_samples[bodies_index_at(t)];
+       }
+
+    // The sample with bodies nearest to t (0 if none has bodies)
+    [[nodiscard]] std::size_t nearest_index(const double t) const noexcept
+       {
+        if( m_bodies_samples.empty() ) return 0;
+        std::size_t k = bodies_index_at(t);
+        if( k+1<m_bodies_times.size() and m_bodies_times[k+1]-t < t-m_bodies_times[k] ) ++k;
+        return m_bodies_samples[k];
+       }
+
+    //-----------------------------------------------------------------------
+    // Values of a field at time t, linearly interpolated between the
+    // samples with bodies around it. The bodies are the ones of
+    // sample(index_at(t)): those no more present in the next sample with
+    // bodies keep their values.
+    // Bodies are matched by id if stored, otherwise by position when
+    // the counts are equal
+    void interpolate(const double t, const Field f, std::vector<double>& values) const
+       {
+        if( f==Field::id ) throw std::runtime_error("Ids cannot be interpolated");
+        if( not has_bodies() ) throw std::runtime_error("No bodies in trajectory file");
+        const std::size_t j = bodies_index_at(t);
+        const SampleView a = sample(m_bodies_samples[j]);
+        load(a, f, values);
+        if( j+1>=m_bodies_samples.size() or t<=m_bodies_times[j] ) return;
+
+        const SampleView b = sample(m_bodies_samples[j+1]);
+        std::vector<double> next;
+        load(b, f, next);
+        const double w = (t - m_bodies_times[j]) / (m_bodies_times[j+1] - m_bodies_times[j]);
+        auto blend = [&](const std::size_t ka, const std::size_t kb) noexcept
+           {
+            values[ka] += w * (next[kb] - values[ka]);
+           };
+        if( m_fields.contains(Field::id) )
+           {// Ids are increasing in each sample
+            const auto ids_a = a.column<std::uint64_t>(Field::id);
+            const auto ids_b = b.column<std::uint64_t>(Field::id);
+            std::size_t kb = 0;
+            for( std::size_t ka=0; ka<ids_a.size(); ++ka )
+               {
+                while( kb<ids_b.size() and ids_b[kb]<ids_a[ka] ) ++kb;
+                if( kb<ids_b.size() and ids_b[kb]==ids_a[ka] ) blend(ka, kb);
+               }
+           }
+        else if( a.size()==b.size() )
+           {
+            for( std::size_t k=0; k<a.size(); ++k ) blend(k, k);
+           }
+       }
+
+ private:
+    [[nodiscard]] bool read_index(const std::string& fpath)
+       {
+        const auto bytes = m_file.bytes();
+        if( bytes.size() < header_size + index_trailer_size ) return false;
+        const std::byte* p = bytes.data() + bytes.size() - index_trailer_size;
+        const auto count = static_cast<std::size_t>(get<std::uint64_t>(p));
+        const auto index_offset = static_cast<std::size_t>(get<std::uint64_t>(p));
+        if( std::string_view(reinterpret_cast<const char*>(p), index_magic.size())!=index_magic or
+            index_offset<header_size or index_offset + index_trailer_size > bytes.size() or count > bytes.size()/index_entry_size or
+            (bytes.size() - index_trailer_size - index_offset) != count*index_entry_size ) return false;
+
+        p = bytes.data() + index_offset;
+        m_times.reserve(count);
+        m_offsets.reserve(count);
+        for( std::size_t i=0; i<count; ++i )
+           {
+            const double time = get<double>(p);
+            const auto offset = static_cast<std::size_t>(get<std::uint64_t>(p));
+            if( offset<header_size or offset + sample_header_size > index_offset ) throw std::runtime_error(fpath + ": corrupted trajectory index");
+            if( offset + check_block(offset, fpath) > index_offset ) throw std::runtime_error(fpath + ": corrupted sample block");
+            add_entry(time, offset, get<std::uint64_t>(p));
+           }
+        return true;
+       }
+
+    // The block at offset must have the size of its bodies count,
+    // so that its columns stay within it
+    std::size_t check_block(const std::size_t offset, const std::string& fpath) const
+       {
+        const std::byte* p = m_file.bytes().data() + offset;
+        const auto block_size = get<std::uint64_t>(p);
+        p += 2*8; // time, content
+        const auto n = get<std::uint64_t>(p);
+        if( n>m_file.size() or block_size!=sample_block_size(m_fields, static_cast<std::size_t>(n), m_value_size) ) throw std::runtime_error(fpath + ": corrupted sample block");
+        return static_cast<std::size_t>(block_size);
+       }
+
+    void add_entry(const double time, const std::size_t offset, const std::uint64_t content)
+       {
+        if( content & Sample::has_bodies )
+           {
+            m_bodies_times.push_back(time);
+            m_bodies_samples.push_back(m_offsets.size());
+           }
+        m_times.push_back(time);
+        m_offsets.push_back(offset);
+       }
+
+    // Position in m_bodies_samples of the last one not after t
+    [[nodiscard]] std::size_t bodies_index_at(const double t) const noexcept
+       {
+        const auto it = std::ranges::upper_bound(m_bodies_times, t);
+        return it==m_bodies_times.begin() ? 0 : static_cast<std::size_t>(it - m_bodies_times.begin()) - 1;
+       }
+
+    void load(const SampleView& s, const Field f, std::vector<double>& values) const
+       {
+        if( m_value_size==4 )
+           {
+            const auto col = s.column<float>(f);
+            values.assign(col.begin(), col.end());
+           }
+        else
+           {
+            const auto col = s.column<double>(f);
+            values.assign(col.begin(), col.end());
+           }
+       }
+
+    template<typename T> [[nodiscard]] static T get(const std::byte*& p) noexcept
+       {
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+       }
+};
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <cmath> // std::isnan
+#include <filesystem> // std::filesystem::*
+static ut::suite<"trajectory"> trajectory_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("trajectory::Reader with mixed samples") = []
+   {
+    // Energies at each step, bodies every 5 steps
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.traj").string();
+       {
+        trajectory::Writer writer(fpath, 2, 1.0);
+        Sample s{};
+        for( int i=0; i<=10; ++i )
+           {
+            s.time = static_cast<double>(i);
+            s.bodies.clear();
+            s.content = Sample::has_energies;
+            if( i%5==0 )
+               {
+                s.content = Sample::has_all;
+                s.bodies.emplace_back(1.0, Universe::Vect{10.0*s.time, 0.0}, Universe::Vect{}, 1);
+                s.bodies.emplace_back(1.0, Universe::Vect{100.0+s.time, 0.0}, Universe::Vect{}, 2);
+                if( i==10 ) s.bodies.emplace_back(1.0, Universe::Vect{}, Universe::Vect{}, 3);
+               }
+            writer.push(s);
+           }
+       }
+    const auto file_size = std::filesystem::file_size(fpath);
+
+    auto check = [&fpath](const char* const what)
+       {
+        const trajectory::Reader reader(fpath);
+        ut::expect( reader.size()==11u and reader.has_bodies() ) << what;
+        ut::expect( reader.index_at(7.0)==5u and reader.index_at(-1.0)==0u and reader.index_at(12.0)==10u ) << what;
+        ut::expect( reader.nearest_index(8.0)==10u and reader.nearest_index(6.0)==5u ) << what;
+        std::vector<double> x;
+        reader.interpolate(7.5, trajectory::Field::x, x);
+        ut::expect( x.size()==2u and x[0]==75.0 and x[1]==107.5 ) << what;
+        reader.interpolate(10.0, trajectory::Field::x, x);
+        ut::expect( x.size()==3u ) << what;
+       };
+    check("indexed");
+
+    // Without the index, the blocks are scanned
+    std::filesystem::resize_file(fpath, file_size - (11*trajectory::index_entry_size + trajectory::index_trailer_size));
+    check("scanned");
+    std::filesystem::remove(fpath);
+   };
+
+ut::test("trajectory::Reader with corrupted bodies count") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.traj").string();
+       {
+        trajectory::Writer writer(fpath, 1, 1.0);
+        Sample s{};
+        s.bodies.emplace_back(1.0, Universe::Vect{}, Universe::Vect{}, 1);
+        writer.push(s);
+       }
+       {
+        std::fstream f(fpath, std::ios::in | std::ios::out | std::ios::binary);
+        const std::uint64_t n = 1'000'000;
+        f.seekp(trajectory::header_size + 3*8);
+        f.write(reinterpret_cast<const char*>(&n), sizeof(n));
+       }
+    ut::expect( ut::throws([&]{ const trajectory::Reader reader(fpath); }) ) << "indexed";
+    std::filesystem::resize_file(fpath, std::filesystem::file_size(fpath) - (trajectory::index_entry_size + trajectory::index_trailer_size));
+    ut::expect( ut::throws([&]{ const trajectory::Reader reader(fpath); }) ) << "scanned";
+    std::filesystem::remove(fpath);
+   };
+
+ut::test("trajectory::Writer on a full disk") = []
+   {
+    if( not std::filesystem::exists("/dev/full") ) return;
+    trajectory::Writer writer("/dev/full", 1, 1.0);
+    Sample s{};
+    s.bodies.emplace_back(1.0, Universe::Vect{}, Universe::Vect{}, 1);
+    auto push_all = [&]{ for( int i=0; i<10'000; ++i ) writer.push(s); };
+    ut::expect( ut::throws(push_all) or ut::throws([&]{ writer.close(); }) );
+   };
+
+ut::test("trajectory::Reader with invalid value size") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.traj").string();
+       {
+        trajectory::Writer writer(fpath, 0, 1.0);
+       }
+       {
+        std::fstream f(fpath, std::ios::in | std::ios::out | std::ios::binary);
+        const std::uint32_t value_size = 3;
+        f.seekp(12);
+        f.write(reinterpret_cast<const char*>(&value_size), sizeof(value_size));
+       }
+    ut::expect( ut::throws([&]{ const trajectory::Reader reader(fpath); }) );
+    std::filesystem::remove(fpath);
+   };
+
+ut::test("trajectory::Reader without bodies") = []
+   {
+    const auto fpath = (std::filesystem::temp_directory_path() / "n-body-test.traj").string();
+       {
+        trajectory::Writer writer(fpath, 0, 1.0);
+        Sample s{};
+        s.content = Sample::has_energies;
+        writer.push(s);
+       }
+    const trajectory::Reader reader(fpath);
+    ut::expect( reader.size()==1u and not reader.has_bodies() );
+    ut::expect( reader.sample(0).Ek()==0.0 and std::isnan(reader.sample(0).Cm().x) );
+    std::vector<double> x;
+    ut::expect( ut::throws([&]{ reader.interpolate(0.0, trajectory::Field::x, x); }) );
+    std::filesystem::remove(fpath);
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
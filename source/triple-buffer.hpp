@@ -0,0 +1,93 @@
+#pragma once
+//  ---------------------------------------------
+//  Lock-free triple buffer
+//  ---------------------------------------------
+#include <array>
+#include <atomic>
+#include <cstdint> // std::uint8_t
+
+
+////////////////////////////////////////////////////////////////////////
+// A producer publishes whole values that a consumer reads at its own
+// pace: neither ever waits, the consumer just gets the latest published.
+// Each side owns a buffer, the third one is exchanged between them
+template<typename T> class TripleBuffer final
+{
+ private:
+    static constexpr std::uint8_t index_mask = 0x3;
+    static constexpr std::uint8_t fresh = 0x4; // Middle buffer not yet seen by the consumer
+
+    std::array<T,3> m_buffers;
+    alignas(64) std::atomic<std::uint8_t> m_middle{1};
+    alignas(64) std::uint8_t m_back = 0; // Producer's
+    alignas(64) std::uint8_t m_front = 2; // Consumer's
+
+ public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side: writes in back() then publishes it
+    [[nodiscard]] T& back() noexcept { return m_buffers[m_back]; }
+    void publish() noexcept
+       {
+        m_back = m_middle.exchange(static_cast<std::uint8_t>(m_back | fresh), std::memory_order_acq_rel) & index_mask;
+       }
+
+    // Consumer side: front() is stable until the next update()
+    [[maybe_unused]] bool update() noexcept
+       {// Returns true if a new value was taken
+        if( (m_middle.load(std::memory_order_relaxed) & fresh)==0 ) return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+        return true;
+       }
+    [[nodiscard]] const T& front() const noexcept { return m_buffers[m_front]; }
+};
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+#include <thread> // std::jthread
+static ut::suite<"TripleBuffer"> triple_buffer_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("TripleBuffer::publish and update") = []
+   {
+    TripleBuffer<int> buf;
+    ut::expect( not buf.update() );
+    buf.back() = 1;
+    buf.publish();
+    ut::expect( buf.update() and buf.front()==1 );
+    ut::expect( not buf.update() and buf.front()==1 );
+    buf.back() = 2;
+    buf.publish();
+    buf.back() = 3;
+    buf.publish();
+    ut::expect( buf.update() and buf.front()==3 ); // Just the latest
+   };
+
+ut::test("TripleBuffer between two threads") = []
+   {
+    constexpr int n = 100'000;
+    TripleBuffer<int> buf;
+    std::jthread producer([&buf]() noexcept { for( int i=1; i<=n; ++i ) { buf.back() = i; buf.publish(); } });
+    int last = 0;
+    bool increasing = true;
+    while( last<n )
+       {
+        if( buf.update() )
+           {
+            increasing = increasing and buf.front()>last;
+            last = buf.front();
+           }
+       }
+    ut::expect( increasing );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
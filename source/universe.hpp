@@ -3,24 +3,106 @@
 //  N-body model
 //  ---------------------------------------------
 #include <vector>
+#include <span>
+#include <cstdint> // std::uint8_t, std::uint64_t
+#include <cmath> // std::isinf
+#include <limits> // std::numeric_limits
+#include <tuple> // std::tie
+#include <algorithm> // std::ranges::sort, std::min, std::max, std::clamp
 #include "math-utilities.hpp" // math::*
 #include "body.hpp" // SphericalBody
+#include "neighbors.hpp" // NeighborList
+#include "pairs-coloring.hpp" // PairsColoring
+#include "parallel.hpp" // par::*
 
 #include "Vect2D.hpp" // Vect2D
 //#include "Vect3D.hpp" // Vect3D
 
 
+class Checkpoint;
+
 ////////////////////////////////////////////////////////////////////////
 class Universe final
 {
+    friend class Checkpoint; // Accesses the whole state
+
  public:
     const double G; // Gravitational constant. Our universe: 6.67408E-11 m³/kg s²
     using Vect = Vect2D;
     using Body = SphericalBody<Vect>;
 
+    enum class CollisionMode : std::uint8_t
+       {
+        coalesce, // Colliding bodies merge
+        bounce // Colliding bodies exchange impulses
+       };
+
+    struct Escape final
+       {
+        double time; // [time] When detected
+        std::uint64_t id;
+        double mass;
+        Vect momentum;
+       };
+
+    struct NewBody final
+       {
+        double mass;
+        Vect pos, spd;
+       };
+
+    static constexpr std::size_t no_index = std::numeric_limits<std::size_t>::max();
+
+    struct Merger final
+       {
+        double time; // [time] Time of impact
+        std::size_t survivor_index; // Index of the merged body in bodies(), or no_index if escaped in the same step
+        std::uint64_t survivor_id, absorbed_id;
+        double survivor_mass, absorbed_mass; // Masses before merging
+        double impact_speed; // [<space>/<time>] Relative speed at impact, of the swept motion of the step
+       };
+
  private:
     std::vector<Body> m_bodies;
+    std::uint64_t m_next_id = 1; // Identifier of next added body
     double t = 0.0; // [time] Elapsed time
+    double m_dt = 0.0; // [time] Last step duration
+    CollisionMode m_collision_mode = CollisionMode::coalesce;
+    double m_Cr = 1.0; // Coefficient of restitution of bounces: (anelastic) 0÷1 (elastic)
+
+    struct Impact final
+       {
+        double s; // Fraction of the last step at the impact
+        std::size_t i, j; // Indexes of the colliding bodies (i<j)
+       };
+    std::vector<Impact> m_impacts; // Collisions detected in last step
+    std::vector<bool> m_merged, m_absorbed; // Bodies involved in the impacts
+    std::vector<Merger> m_mergers; // Coalescences of last step
+    std::vector<std::size_t> m_new_index; // Indexes after the disposal of bodies
+
+    double m_escape_radius = std::numeric_limits<double>::infinity(); // [<space>] From center of mass
+    std::vector<Body> m_escaped; // Unbound bodies, just drifting
+    std::vector<Escape> m_escapes; // Escapes detected in last check
+    std::vector<bool> m_escaping;
+    double m_escaped_mass = 0.0;
+    Vect m_escaped_momentum; // At the moment of the escapes
+    NeighborList<Vect> m_neighbors; // Collision candidates
+
+    std::vector<std::vector<Impact>> m_found; // Contacts found by each worker
+    PairsColoring<Impact> m_coloring; // Contacts grouped by color
+    std::vector<double> m_impact_s; // Earliest impact of each body in last step
+
+    struct Totals final
+       {// Gathered by the last verlet step, so the diagnostics come almost
+        // for free; invalidated when the bodies are changed otherwise
+        bool valid = false;
+        double Ek = 0.0; // Kinetic energy
+        double Eu = 0.0; // Gravitational energy
+        double M = 0.0; // Total mass
+        Vect P; // Momentum
+        Vect MR; // ∑ m·pos
+       };
+    Totals m_totals;
 
  public:
     Universe(const double g) noexcept
@@ -38,68 +120,284 @@ class Universe final
             ibody->evolve_speed(dt);
             ibody->evolve_position(dt);
            }
+        evolve_escaped(dt);
+        m_totals.valid = false; // Positions moved after the forces
+        m_dt = dt;
         t += dt;
        }
 
     //------------------------------------------------------------------------
     void evolve_verlet(const double dt) noexcept
        {
+        Totals totals;
         for( Body& body : m_bodies )
            {
             body.evolve_speed(dt/2);
             body.evolve_position(dt);
+            totals.M += body.mass();
+            totals.MR += body.mass() * body.position();
            }
 
         for( auto ibody=m_bodies.begin(); ibody!=m_bodies.end(); ++ibody )
            {
-            const Vect f = gravitational_force_on_body(ibody);
+            const Vect f = gravitational_force_on_body(ibody, totals.Eu);
             ibody->apply_force(f);
             ibody->evolve_speed(dt/2);
+            totals.Ek += ibody->kinetic_energy();
+            totals.P += ibody->mass() * ibody->speed();
            }
+        evolve_escaped(dt);
+        totals.Eu *= 0.5; // Each pair was counted twice
+        totals.valid = true;
+        m_totals = totals;
 
+        m_dt = dt;
         t += dt;
        }
 
     //------------------------------------------------------------------------
-    void handle_collisions() noexcept
-       {
-        // Normal collisions:
-        //for( auto ibody=m_bodies.begin(); ibody!=m_bodies.end(); ++ibody )
-        //   {
-        //    for( auto iother=ibody+1; iother!=m_bodies.end(); ++iother )
-        //       {
-        //
-        //        ibody->handle_possible_collision_with(*iother);
-        //       }
-        //   }
+    void evolve_escaped(const double dt) noexcept
+       {// Ballistic motion, no more forces
+        for( Body& body : m_escaped ) body.evolve_position(dt);
+       }
+
+    //------------------------------------------------------------------------
+    void handle_escapers()
+       {// Bodies beyond the escape radius from the center of mass and with
+        // positive energy relative to it are unbound: dropped from the
+        // force computation and moved to the escaped ones
+        m_escapes.clear();
+        if( m_bodies.size()<2 or std::isinf(m_escape_radius) ) return;
 
+        double M = 0.0;
+        Vect Mc, p; // Mass weighted position, momentum
+        for( const Body& body : m_bodies )
+           {
+            M += body.mass();
+            Mc += body.mass() * body.position();
+            p += body.mass() * body.speed();
+           }
+        const Vect c = Mc / M;
+
+        m_escaping.assign(m_bodies.size(), false);
+        const double r_escape2 = math::square(m_escape_radius);
+        for( std::size_t i=0; i<m_bodies.size(); ++i )
+           {
+            const Body& body = m_bodies[i];
+            if( (body.position() - c).norm2()<=r_escape2 ) continue;
+            // Two body energy, approximating the others as a point mass
+            // in their own center of mass
+            const double M_rest = M - body.mass();
+            if( M_rest<=0.0 ) continue;
+            const Vect r = body.position() - (Mc - body.mass() * body.position()) / M_rest;
+            const Vect v = body.speed() - (p - body.mass() * body.speed()) / M_rest;
+            const double mu = body.mass() * M_rest / M; // Reduced mass
+            const double E = 0.5 * mu * v.norm2() - G * M_rest * body.mass() / r.norm();
+            if( E>0.0 )
+               {
+                m_escaping[i] = true;
+                m_escapes.push_back({t, body.id(), body.mass(), body.mass() * body.speed()});
+                m_escaped_mass += body.mass();
+                m_escaped_momentum += body.mass() * body.speed();
+                m_escaped.push_back(body);
+               }
+           }
+        if( not m_escapes.empty() )
+           {
+            dispose_bodies(m_escaping);
+            m_totals.valid = false;
+           }
+       }
+
+    //------------------------------------------------------------------------
+    void handle_collisions()
+       {
+        m_mergers.clear();
+        m_neighbors.update(m_bodies);
+        switch( m_collision_mode )
+           {
+            case CollisionMode::coalesce:
+                coalesce_colliding_bodies();
+                break;
+
+            case CollisionMode::bounce:
+                bounce_colliding_bodies();
+                break;
+           }
+       }
+
+    //------------------------------------------------------------------------
+    void coalesce_colliding_bodies()
+       {
         // Coalescing colliding bodies
         // (this solves tricky problems like the proper collision detection,
         //  time backtracking, resting position)
-        for( auto ibody=m_bodies.begin(); ibody!=m_bodies.end(); ++ibody )
+        // The swept spheres of the last step are tested, so fast bodies
+        // cannot tunnel through each other; the impacts are then resolved
+        // in chronological order
+        m_impacts.clear();
+        for( std::size_t i=0; i<m_bodies.size(); ++i )
            {
-            for( auto iother=ibody+1; iother!=m_bodies.end();  )
+            for( const std::size_t j : m_neighbors.neighbors_of(i) )
                {
-                if( iother->displacement_from(*ibody).norm2() <= math::square(ibody->radius() + iother->radius()) )
+                if( const auto s = m_bodies[i].time_of_impact_with(m_bodies[j]) )
                    {// Collision detected!
-                    ibody->coalesce_with(*iother);
-                    // Now dispose the coalesced body
-                    // Note: This won't invalidate ibody iterator, because precedes iother
-                    assert(ibody<iother);
-                    iother = m_bodies.erase(iother);
+                    m_impacts.push_back({*s, i, j});
                    }
-                else
+               }
+           }
+        if( m_impacts.empty() ) return;
+        m_totals.valid = false;
+        std::ranges::sort(m_impacts, [](const Impact& a, const Impact& b) noexcept
+                                       { return std::tie(a.s,a.i,a.j) < std::tie(b.s,b.i,b.j); });
+
+        // A body already merged in this step has a different trajectory
+        // than the one swept, its further impacts will be caught next step
+        m_merged.assign(m_bodies.size(), false);
+        m_absorbed.assign(m_bodies.size(), false);
+        for( const Impact& impact : m_impacts )
+           {
+            if( m_merged[impact.i] or m_merged[impact.j] ) continue;
+            const Body& survivor = m_bodies[impact.i];
+            const Body& absorbed = m_bodies[impact.j];
+            m_mergers.push_back({ t - (1.0-impact.s)*m_dt,
+                                  impact.i, // Adjusted by the disposals
+                                  survivor.id(), absorbed.id(),
+                                  survivor.mass(), absorbed.mass(),
+                                  (survivor.speed_during_last_step(m_dt) - absorbed.speed_during_last_step(m_dt)).norm() });
+            m_bodies[impact.i].coalesce_with(m_bodies[impact.j]);
+            m_merged[impact.i] = m_merged[impact.j] = true;
+            m_absorbed[impact.j] = true;
+           }
+
+        // Now dispose the coalesced bodies
+        dispose_bodies(m_absorbed);
+       }
+
+    //------------------------------------------------------------------------
+    void dispose_bodies(const std::vector<bool>& to_dispose)
+       {// Preserves the order of the others, noting their new indexes
+        std::size_t n = 0;
+        m_new_index.resize(m_bodies.size());
+        for( std::size_t i=0; i<m_bodies.size(); ++i )
+           {
+            m_new_index[i] = n;
+            if( not to_dispose[i] )
+               {
+                if( n!=i ) m_bodies[n] = std::move(m_bodies[i]);
+                ++n;
+               }
+           }
+        m_bodies.erase(m_bodies.begin() + static_cast<std::ptrdiff_t>(n), m_bodies.end());
+        m_neighbors.invalidate();
+
+        // The survivors of the last mergers may have moved or gone
+        for( Merger& merger : m_mergers )
+           {
+            if( merger.survivor_index==no_index ) continue;
+            merger.survivor_index = to_dispose[merger.survivor_index] ? no_index : m_new_index[merger.survivor_index];
+           }
+       }
+
+    //------------------------------------------------------------------------
+    void bounce_colliding_bodies()
+       {
+        const std::size_t n = m_bodies.size();
+
+        // Contacts detection, in parallel
+        const std::size_t k = par::chunks_count(n, 512);
+        m_found.resize(k);
+        par::for_chunks(n, k, [this](const std::size_t c, const std::size_t i_begin, const std::size_t i_end)
+           {
+            std::vector<Impact>& found = m_found[c];
+            found.clear();
+            for( std::size_t i=i_begin; i<i_end; ++i )
+               {
+                for( const std::size_t j : m_neighbors.neighbors_of(i) )
                    {
-                    ++iother;
+                    if( const auto s = m_bodies[i].time_of_impact_with(m_bodies[j]) )
+                       {
+                        found.push_back({*s, i, j});
+                       }
                    }
                }
+           });
+        m_impacts.clear();
+        for( const auto& found : m_found ) m_impacts.insert(m_impacts.end(), found.begin(), found.end());
+        if( m_impacts.empty() ) return;
+        m_totals.valid = false;
+
+        // Coloring the contacts so that a body appears at most once per color:
+        // each color can be resolved in parallel, and the colors in sequence
+        // see the speeds updated by the previous ones, so that a body touching
+        // many others conserves the energy like in a chain of pair collisions
+        m_coloring.assign(m_impacts, n);
+        m_impact_s.assign(n, 1.0);
+
+        // Resolve the bounces color by color, noting the earliest impact of
+        // the bodies actually bounced (touching ones moving apart are not)
+        for( std::size_t color=0; color<m_coloring.colors_count(); ++color )
+           {
+            const std::span<const Impact> impacts = m_coloring.color(color);
+            par::for_chunks(impacts.size(), par::chunks_count(impacts.size(), 256), [this, impacts](const std::size_t, const std::size_t b, const std::size_t e)
+               {
+                for( std::size_t idx=b; idx<e; ++idx )
+                   {
+                    const Impact& impact = impacts[idx];
+                    Body& body = m_bodies[impact.i];
+                    Body& other = m_bodies[impact.j];
+                    const Vect I = body.collision_impulse_from(other, impact.s, m_Cr);
+                    if( I.is_null() ) continue;
+                    body.apply_impulse(I);
+                    other.apply_impulse(-I);
+                    m_impact_s[impact.i] = std::min(m_impact_s[impact.i], impact.s);
+                    m_impact_s[impact.j] = std::min(m_impact_s[impact.j], impact.s);
+                   }
+               });
            }
+
+        // The bounced bodies redo the rest of the step with the new speed
+        par::for_chunks(n, k, [this](const std::size_t, const std::size_t i_begin, const std::size_t i_end)
+           {
+            for( std::size_t i=i_begin; i<i_end; ++i )
+               {
+                if( m_impact_s[i]<1.0 ) m_bodies[i].replay_last_step_from(m_impact_s[i], m_dt);
+               }
+           });
+       }
+
+    // Distance beyond the radii within which collision candidates are tracked
+    void set_collision_skin(const double skin) noexcept { m_neighbors.set_skin(skin); }
+
+    [[maybe_unused]] Universe& set_collision_mode(const CollisionMode mode) noexcept
+       {
+        m_collision_mode = mode;
+        return *this;
+       }
+    [[nodiscard]] CollisionMode collision_mode() const noexcept { return m_collision_mode; }
+
+    [[maybe_unused]] Universe& set_restitution(const double Cr) noexcept
+       {
+        m_Cr = std::clamp(Cr, 0.0, 1.0);
+        return *this;
+       }
+    [[nodiscard]] double restitution() const noexcept { return m_Cr; }
+
+    // Distance from the center of mass beyond which unbound bodies are dropped
+    [[maybe_unused]] Universe& set_escape_radius(const double r) noexcept
+       {
+        m_escape_radius = r;
+        return *this;
        }
 
     [[nodiscard]] double time() const noexcept { return t; }
+    [[nodiscard]] double last_step() const noexcept { return m_dt; }
 
+    // The following quantities are taken from the last step when possible,
+    // otherwise computed
     [[nodiscard]] double kinetic_energy() const noexcept
        {// K = ∑ ½ m·V²
+        if( m_totals.valid ) return m_totals.Ek;
         double Ek = 0.0;
         for( const Body& body : m_bodies ) Ek += body.kinetic_energy();
         return Ek;
@@ -107,6 +405,7 @@ class Universe final
 
     [[nodiscard]] double gravitational_energy() const noexcept
        {// U = ½ ∑ -G · mi·mj / d
+        if( m_totals.valid ) return m_totals.Eu;
         double Eu = 0.0;
         for( auto ibody=m_bodies.begin(); ibody!=m_bodies.end(); ++ibody )
            {// Iterate over all the other bodies
@@ -120,8 +419,17 @@ class Universe final
 
     [[nodiscard]] double total_energy() const noexcept { return kinetic_energy() + gravitational_energy(); }
 
+    [[nodiscard]] Vect momentum() const noexcept
+       {// P = ∑ m·V
+        if( m_totals.valid ) return m_totals.P;
+        Vect p;
+        for( const Body& body : m_bodies ) p += body.mass() * body.speed();
+        return p;
+       }
+
     [[nodiscard]] Vect center_of_mass() const noexcept
-       {// U = ∑ m·vpos / M
+       {// C = ∑ m·pos / M
+        if( m_totals.valid ) return m_totals.MR / m_totals.M;
         Vect c;
         double total_mass = 0.0;
         for( const Body& body : m_bodies )
@@ -143,11 +451,135 @@ class Universe final
         return f;
        }
 
+    [[nodiscard]] Vect gravitational_force_on_body( std::vector<Body>::const_iterator ibody, double& U ) const noexcept
+       {// Also accumulating the gravitational energy of the body with the others
+        Vect f;
+        for( auto iother=m_bodies.begin(); iother!=ibody; ++iother )
+            f += iother->gravitational_force_on(*ibody,G,U);
+        for( auto iother=ibody+1; iother!=m_bodies.end(); ++iother )
+            f += iother->gravitational_force_on(*ibody,G,U);
+        return f;
+       }
+
     [[maybe_unused]] Universe& add_body(const double m, const Vect& pos, const Vect& spd)
        {
-        m_bodies.emplace_back(m,pos,spd);
+        m_bodies.emplace_back(m,pos,spd,m_next_id++);
+        m_totals.valid = false; // Collision candidates searched at next handle_collisions()
+        return *this;
+       }
+
+    [[maybe_unused]] Universe& add_bodies(const std::span<const NewBody> new_bodies)
+       {// One reallocation at most, and at next handle_collisions() just the collision candidates of the new bodies are searched
+        m_bodies.reserve(m_bodies.size() + new_bodies.size());
+        for( const NewBody& body : new_bodies ) m_bodies.emplace_back(body.mass, body.pos, body.spd, m_next_id++);
+        m_totals.valid = false;
         return *this;
        }
 
     [[nodiscard]] const std::vector<Body>& bodies() const noexcept { return m_bodies; }
+    [[nodiscard]] const std::vector<Merger>& mergers() const noexcept { return m_mergers; }
+    [[nodiscard]] const std::vector<Body>& escaped() const noexcept { return m_escaped; }
+    [[nodiscard]] const std::vector<Escape>& escapes() const noexcept { return m_escapes; }
+    [[nodiscard]] double escaped_mass() const noexcept { return m_escaped_mass; }
+    [[nodiscard]] const Vect& escaped_momentum() const noexcept { return m_escaped_momentum; }
 };
+
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+#ifdef TEST_UNITS ///////////////////////////////////////////////////////////
+static ut::suite<"Universe"> universe_tests = []
+{////////////////////////////////////////////////////////////////////////////
+
+ut::test("Universe::mergers with escapes in the same step") = []
+   {
+    ut::test("survivor shifted by an escape") = []
+       {
+        Universe u(1.0);
+        u.set_escape_radius(100.0);
+        u.add_body(1.0, {1000.0,0.0}, {100.0,0.0}) // Escaping
+         .add_body(10.0, {0.0,0.0}, {1.0,0.0})
+         .add_body(10.0, {3.0,0.0}, {-1.0,0.0});
+        u.evolve_verlet(1.0);
+        u.handle_collisions();
+        u.handle_escapers();
+        ut::expect( u.mergers().size()==1 and u.escapes().size()==1 and u.bodies().size()==1 );
+        ut::expect( u.mergers().front().survivor_index==0 );
+        ut::expect( u.bodies().front().id()==u.mergers().front().survivor_id );
+       };
+
+    ut::test("survivor escaped") = []
+       {
+        Universe u(1.0);
+        u.set_escape_radius(100.0);
+        u.add_body(1000.0, {0.0,0.0}, {0.0,0.0})
+         .add_body(10.0, {1000.0,0.0}, {101.0,0.0}) // Merging, then escaping
+         .add_body(10.0, {1003.0,0.0}, {99.0,0.0});
+        u.evolve_verlet(1.0);
+        u.handle_collisions();
+        u.handle_escapers();
+        ut::expect( u.mergers().size()==1 and u.escapes().size()==1 and u.bodies().size()==1 );
+        ut::expect( u.mergers().front().survivor_index==Universe::no_index );
+       };
+   };
+
+ut::test("Universe::handle_escapers energy relative to the others") = []
+   {// Two equal bodies: seen from the common center of mass, each carries
+    // half of the relative speed and the potential of its own mass too
+    Universe u(1.0);
+    u.set_escape_radius(100.0);
+    u.add_body(100.0, {0.0,0.0}, {0.0,0.0})
+     .add_body(100.0, {1000.0,0.0}, {0.0,1.0}); // Unbound: 0.5 v^2 > G (m1+m2)/r
+    u.handle_escapers();
+    ut::expect( u.escapes().size()==2u and u.bodies().empty() );
+
+    Universe bound(1.0);
+    bound.set_escape_radius(100.0);
+    bound.add_body(100.0, {0.0,0.0}, {0.0,0.0})
+         .add_body(100.0, {1000.0,0.0}, {0.0,0.6});
+    bound.handle_escapers();
+    ut::expect( bound.escapes().empty() );
+   };
+
+ut::test("Universe::bounce_colliding_bodies separating bodies") = []
+   {// Touching bodies moving apart get no impulse and keep their step
+    Universe u(1.0);
+    u.set_collision_mode(Universe::CollisionMode::bounce);
+    u.add_body(10.0, {0.0,0.0}, {-5.0,0.0})
+     .add_body(10.0, {u.bodies().front().radius(),0.0}, {5.0,0.0})
+     .add_body(5000.0, {0.0,300.0}, {0.0,0.0}); // Bending the trajectories
+    u.evolve_verlet(0.1);
+    const std::vector<Universe::Body> evolved = u.bodies();
+    u.handle_collisions();
+    bool same = true;
+    for( std::size_t i=0; i<evolved.size(); ++i )
+       {
+        same = same and u.bodies()[i].position()==evolved[i].position()
+                    and u.bodies()[i].speed()==evolved[i].speed();
+       }
+    ut::expect( same );
+   };
+
+ut::test("Universe::mergers impact speed") = []
+   {// Two bodies falling on each other from rest, with a coarse step:
+    // at the contact ½·v² = G·M·(1/R - 1/D)
+    Universe u(1.0);
+    u.add_body(1000.0, {0.0,0.0}, {0.0,0.0})
+     .add_body(1000.0, {100.0,0.0}, {0.0,0.0});
+    const double R = 2.0 * u.bodies().front().radius();
+    const double expected = std::sqrt(2.0 * 2000.0 * (1.0/R - 1.0/100.0));
+    for( int i=0; i<1000 and u.mergers().empty(); ++i )
+       {
+        u.evolve_verlet(0.2);
+        u.handle_collisions();
+       }
+    ut::expect( u.mergers().size()==1 );
+    ut::expect( not u.mergers().empty() and std::abs(u.mergers().front().impact_speed - expected)<0.05*expected );
+   };
+
+};///////////////////////////////////////////////////////////////////////////
+#endif // TEST_UNITS ////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
@@ -10,6 +10,16 @@ namespace ut = boost::ut;
 #include "sfml-addons.hpp" // sfadd::*
 #include "sfml-addons-color.hpp" // sfadd::Color
 #include "universe.hpp" // Universe
+#include "scenarios.hpp" // scenarios::*
+#include "simulation.hpp" // Simulation
+#include "checkpoint.hpp" // Checkpoint, CheckpointWriter
+#include "trajectory-file.hpp" // trajectory::*
+#include "trajectory-codec.hpp" // qtraj::*
+#include "spsc-queue.hpp" // SpscQueue
+#include "triple-buffer.hpp" // TripleBuffer
+#include "pairs-coloring.hpp" // PairsColoring
+#include "parallel.hpp" // par::*
+#include "async-sink.hpp" // AsyncSink
 
 int main()
 {
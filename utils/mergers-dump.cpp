@@ -0,0 +1,35 @@
+//  ---------------------------------------------
+//  Prints a mergers log as csv
+//  ---------------------------------------------
+#include <iostream>
+#include <format>
+#include <exception>
+
+#include "merger-log.hpp" // mergers::*
+
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if( argc!=2 )
+       {
+        std::cerr << "Usage: mergers-dump <mergers-log-file>\n";
+        return 2;
+       }
+
+    try{
+        const auto log = mergers::read_file(argv[1]);
+        std::cout << "time,survivor-index,survivor-id,absorbed-id,survivor-mass,absorbed-mass,impact-speed\n";
+        for( const auto& m : log )
+           {
+            std::cout << std::format("{},{},{},{},{},{},{}\n", m.time, m.survivor_index, m.survivor_id, m.absorbed_id, m.survivor_mass, m.absorbed_mass, m.impact_speed);
+           }
+       }
+    catch( std::exception& e )
+       {
+        std::cerr << e.what() << '\n';
+        return 1;
+       }
+
+    return 0;
+}